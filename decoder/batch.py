@@ -0,0 +1,75 @@
+import threading
+import time
+
+""" Groups database writes into transactions. A transaction is committed after a number of
+statements or after a time, whatever comes first. Statements are prepared once and reused.
+All access to the connection goes through this class, so it can be used from several threads.
+Periodic maintenance (e.g. purging old rows) can be run by the flusher thread. """
+class Batch:
+	def __init__(self, db, count=200, interval=1.0):
+		self.db = db
+		self.count = count
+		self.interval = interval
+		self.pending = 0
+		self.since = time.time()
+		self.cursors = {}
+		self.tasks = []
+		self.lock = threading.RLock()
+
+		flusher = threading.Thread(target=self._flusher)
+		flusher.daemon = True
+		flusher.start()
+
+	def _cursor(self, sql):
+		if sql not in self.cursors:
+			self.cursors[sql] = self.db.cursor(prepared=True)
+		return self.cursors[sql]
+
+	def _flusher(self):
+		while True:
+			time.sleep(self.interval)
+			with self.lock:
+				for task in self.tasks:
+					if task[2] <= time.time():
+						task[2] = time.time() + task[1]
+						task[0](self)
+				if self.pending and self.since + self.interval <= time.time():
+					self.flush()
+
+	def _execute(self, sql, params):
+		with self.lock:
+			cur = self._cursor(sql)
+			cur.execute(sql, params)
+			if not self.pending:
+				self.since = time.time()
+			self.pending += 1
+			if self.pending >= self.count:
+				self.flush()
+			return cur
+
+	""" Queues a write statement, returns the row ID of an inserted auto increment row """
+	def execute(self, sql, params=()):
+		with self.lock:
+			return self._execute(sql, params).lastrowid
+
+	""" Queues a write statement, returns the number of rows it changed (0 for an ignored insert) """
+	def modify(self, sql, params=()):
+		with self.lock:
+			return self._execute(sql, params).rowcount
+
+	""" Runs func(batch) in the flusher thread every interval seconds, the first time right away """
+	def every(self, interval, func):
+		with self.lock:
+			self.tasks.append([func, interval, 0])
+
+	""" Runs a query, uncommitted writes of this batch are visible """
+	def query(self, sql, params=()):
+		with self.lock:
+			cur = self.db.cursor()
+			cur.execute(sql, params)
+			return cur.fetchall()
+
+	def flush(self):
+		with self.lock:
+			self.db.commit()
+			self.pending = 0
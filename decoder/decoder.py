@@ -1,19 +1,21 @@
 #!/usr/bin/python3
 
-import serial,re,io
+import re
 import sys
 import argparse
-import telnetlib
 import time
 import mysql.connector as mariadb
 import image
 import position
+from batch import Batch
+import ingest
 
 # Parse arguments from terminal
 parser = argparse.ArgumentParser(description='APRS/SSDV decoder')
 parser.add_argument('-c', '--call', help='Callsign of the station', default='DL7AD')
-parser.add_argument('-d', '--device', help='Serial device (\'-\' for stdin)', default='-')
+parser.add_argument('-d', '--device', help='Source, can be given several times: serial device, \'-\' for stdin, \'I\' for APRS-IS or kiss:host:port for KISS over TCP', action='append')
 parser.add_argument('-b', '--baudrate', help='Baudrate for serial device', default=9600, type=int)
+parser.add_argument('-t', '--dedupe', help='Time in seconds in which the same packet from another source is dropped', default=30, type=int)
 parser.add_argument('-v', '--verbose', help='Activates more debug messages', action="store_true")
 args = parser.parse_args()
 
@@ -78,6 +80,20 @@ db.cursor().execute("""
 		PRIMARY KEY (`call`,`id`,`packetID`)
 	)
 """)
+db.cursor().execute("""
+	CREATE TABLE IF NOT EXISTS `images`
+	(
+		`id` INTEGER AUTO_INCREMENT,
+		`call` VARCHAR(10),
+		`imageID` INTEGER,
+		`rxtime` INTEGER,
+		PRIMARY KEY (`id`)
+	)
+""")
+# Continue numbering after the images received before the `images` table existed
+cur = db.cursor()
+cur.execute("SELECT IFNULL(MAX(`id`),-1)+1 FROM `image`")
+cur.execute("ALTER TABLE `images` AUTO_INCREMENT = %d" % cur.fetchall()[0][0])
 db.cursor().execute("""
 	CREATE TABLE IF NOT EXISTS `directs`
 	(
@@ -87,7 +103,60 @@ db.cursor().execute("""
 		PRIMARY KEY (`call`,`rxtime`)
 	)
 """)
-
+db.cursor().execute("CREATE INDEX IF NOT EXISTS `position_rxtime` ON `position` (`call`,`rxtime`)")
+db.cursor().execute("CREATE INDEX IF NOT EXISTS `position_org` ON `position` (`call`,`org`,`rxtime`)")
+db.cursor().execute("CREATE INDEX IF NOT EXISTS `position_gps` ON `position` (`call`,`org`,`gps_time`)")
+db.cursor().execute("CREATE INDEX IF NOT EXISTS `image_rxtime` ON `image` (`call`,`rxtime`)")
+db.cursor().execute("CREATE INDEX IF NOT EXISTS `image_id` ON `image` (`id`,`packetID`)")
+db.cursor().execute("""
+	CREATE TABLE IF NOT EXISTS `activity`
+	(
+		`call` VARCHAR(10),
+		`type` VARCHAR(3),
+		`minute` INTEGER,
+		`count` INTEGER,
+		PRIMARY KEY (`call`,`type`,`minute`)
+	)
+""")
+# Fill the activity counters of the last day from the packets received before the table existed
+cur = db.cursor()
+cur.execute("SELECT COUNT(*) FROM `activity`")
+if not cur.fetchall()[0][0]:
+	since = int(time.time()) - 86400
+	for (table,typ) in [("`position` WHERE `org`='pos' AND","'pos'"), ("`position` WHERE `org`='log' AND","'log'"),
+	                    ("`image` WHERE","'img'"), ("`directs` WHERE","'dir'")]:
+		cur.execute("""INSERT INTO `activity` (`call`,`type`,`minute`,`count`)
+			SELECT `call`,%s,`rxtime` DIV 60,COUNT(*) FROM %s `rxtime` >= %d
+			GROUP BY `call`,`rxtime` DIV 60""" % (typ, table, since))
+	db.commit()
+batch = Batch(db)
+batch.every(3600, position.purge_activity)
+
+
+callreg = "([A-Z]{2}[0-9][A-Z]{1,3}(?:-[0-9]{1,2})?)" # Callregex to filter bad igated packets
+packet = re.compile("^" + callreg + "\>APECAN([^:]*):(?:" +
+	"[\=|!](.{13})(.*?)\|(.*)\|" + # Position packet: position, comment, telemetry
+	"|\{\{(I|L)(.*)" +               # Data packet: type, data
+	"|:(.{9}):Directs=(.*))")         # Directs message: addressee, directs
+
+heard = {} # (call, payload) => time first received
+last_purge = time.time()
+
+""" Returns True if the same packet has been received recently (e.g. via another path or source) """
+def duplicate(call, payload):
+	global last_purge
+
+	now = time.time()
+	if last_purge + args.dedupe < now:
+		for key in [key for key in heard if heard[key] + args.dedupe < now]:
+			del heard[key]
+		last_purge = now
+
+	key = (call, payload)
+	if key in heard and heard[key] + args.dedupe >= now:
+		return True
+	heard[key] = now
+	return False
 
 """ Packet handler for received APRS packets"""
 def received_data(data):
@@ -95,107 +164,51 @@ def received_data(data):
 	data = data.strip()
 
 	# Parse line and detect data
-	callreg = "([A-Z]{2}[0-9][A-Z]{1,3}(?:-[0-9]{1,2})?)" # Callregex to filter bad igated packets
-
-	all = re.search("^" + callreg + "\>APECAN(.*?):", data)
-	pos = re.search("^" + callreg + "\>APECAN(.*?):[\=|!](.{13})(.*?)\|(.*)\|", data)
-	dat = re.search("^" + callreg + "\>APECAN(.*?):\{\{(I|L)(.*)", data)
-	dir = re.search("^" + callreg + "\>APECAN(.*?)::(.{9}):Directs=(.*)", data)
-
-	if pos or dat or dir:
-		# Debug
-		if args.verbose:
-			print('='*100)
-			print(data)
-			print('-'*100)
-
-		call = all.group(1).split(' ')[-1]
-		rxer = all.group(2).split(',')[-1]
-		if not len(rxer): rxer = args.call
-
-		if pos: # Position packet (with comment and telementry)
-
-			comm = pos.group(4)
-			position.insert_position(db, call, comm, 'pos')
-
-		elif dat: # Data packet (Image or Logging)
-
-			typ  = dat.group(3)
-			data = dat.group(4)
-
-			if typ is 'I': # Image packet
-				image.insert_image(db, rxer, call, data)
-			elif typ is 'L': # Log packet
-				position.insert_position(db, call, data, 'log')
-
-		elif dir: # Directs packet
-			position.insert_directs(db, call, dir.group(4))
-
-if args.device == 'I': # Source APRS-IS
-
-	print('Connect to APRS-IS')
-	try:
-		tn = telnetlib.Telnet("euro.aprs2.net", 14580, 3)
-		tn.write(("user %s filter u/APECAN\n" % args.call).encode('ascii'))
-		print('Connected')
-	except Exception as e:
-		print('Could not connect to APRS-IS: %s' % str(e))
-		print('exit...')
-		sys.exit(1)
-
-	wdg = time.time() + 10 # Connection watchdog
-	while True:
-		# Read data
-		try:
-			buf = tn.read_until(b"\n").decode('charmap')
-		except EOFError: # Server has connection closed
-			wdg = 0 # Tell watchdog to reconnect
-		except UnicodeDecodeError:
-			pass
-
-		# Watchdog reconnection
-		if wdg < time.time():
-			print('APRS-IS connection lost... reconnect')
-			try:
-				tn = telnetlib.Telnet("euro.aprs2.net", 14580, 3)
-				tn.write(("user %s filter u/APECAN\n" % args.call).encode('ascii'))
-				print('Connected')
-				wdg = time.time() + 10
-			except Exception as e:
-				print('Could not connect to APRS-IS: %s' % str(e))
-				print('Try again...')
-
-		if '# aprsc' in buf: # Watchdog reload
-			print('Ping from APRS-IS')
-			wdg = time.time() + 30
-		else: # Data handling
-			received_data(buf)
-
-		#time.sleep(0.001)
-
-elif args.device is '-': # Source stdin
-
-	while True:
-		received_data(sys.stdin.readline())
-
-else: # Source Serial connection
-
-	try:
-		serr = serial.Serial(
-			port=args.device,
-			baudrate=args.baudrate,
-		)
-	except:
-		sys.stderr.write('Error: Could not open serial port\n')
-		sys.exit(1)
-
-	while True:
-		data = ''
-		while True:
-			b = serr.read(1)
-			if chr(b[0]) == '\r' or chr(b[0]) == '\n':
-				break
-			data += chr(b[0])
-
-		received_data(data)
-
+	m = packet.search(data)
+	if m is None:
+		return
+
+	call = m.group(1)
+	if duplicate(call, data[data.index(':'):]):
+		return
+
+	# Debug
+	if args.verbose:
+		print('='*100)
+		print(data)
+		print('-'*100)
+
+	rxer = m.group(2).split(',')[-1]
+	if not len(rxer): rxer = args.call
+
+	if m.group(3) is not None: # Position packet (with comment and telementry)
+
+		position.insert_position(batch, call, m.group(4), 'pos')
+
+	elif m.group(6) is not None: # Data packet (Image or Logging)
+
+		typ  = m.group(6)
+		data = m.group(7)
+
+		if typ == 'I': # Image packet
+			image.insert_image(batch, rxer, call, data)
+		elif typ == 'L': # Log packet
+			position.insert_position(batch, call, data, 'log')
+
+	else: # Directs packet
+		position.insert_directs(batch, call, m.group(9))
+
+sources = []
+for device in args.device or ['-']:
+	if device == 'I': # Source APRS-IS
+		sources.append(ingest.AprsIs(args.call))
+	elif device == '-': # Source stdin
+		sources.append(ingest.Stdin())
+	elif device.startswith('kiss:'): # Source KISS over TCP
+		(host, port) = device[5:].rsplit(':', 1)
+		sources.append(ingest.KissTcp(host, int(port)))
+	else: # Source Serial connection
+		sources.append(ingest.SerialTnc(device, args.baudrate))
+
+ingest.run(sources, received_data)
+batch.flush() # All sources at their end
@@ -13,6 +13,9 @@ class Image {
 		$this->packetID = (int)$sqlResult['packetID'];
 		$this->count = (int)$sqlResult['count'];
 
+		// Written by the decoder once no more packets are received for the image
+		$this->thumb = file_exists(__DIR__ . "/images/" . str_replace('-', '', $this->call) . "-" . $this->id . ".thumb.jpg");
+
 	}
 }
 ?>
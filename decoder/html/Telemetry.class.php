@@ -6,6 +6,7 @@ class Telemetry {
 		$this->org = $sqlResult['org'];
 
 		$this->rxtime = (int)$sqlResult['rxtime'];
+		$this->ordertime = (int)$sqlResult['ordertime'];
 
 		$this->call = $sqlResult['call'];
 
@@ -74,7 +74,10 @@ class Tracker {
 		$query = Database::getInstance()->query("SELECT * FROM `position` WHERE `call` = '" . Database::getInstance()->escape_string($this->call) . "' ORDER BY `rxtime` DESC LIMIT 1");
 		return new Telemetry($query->fetch_assoc());
 	}
-	function getTelemetry($from, $to=NULL) {
+	/* Returns the datasets in a time window. If $buckets is set, the window is divided into that
+	 * many time buckets (e.g. the width of a chart in pixels) and one averaged dataset is returned
+	 * per bucket. Error flags are ORed, so a bucket shows an error if any of its datasets did. */
+	function getTelemetry($from, $to=NULL, $buckets=0) {
 		if(is_null($to))
 			$to = time() + 1;
 
@@ -84,15 +87,7 @@ class Tracker {
 		if($to - $from > 64281600)
 			$from = $to - 64281600; // Max. 744 days (2 non leap years + 14 weeks)
 
-		$query = Database::getInstance()->query("
-			SELECT *,
-			CASE
-				WHEN `org` = 'pos' THEN `rxtime`
-				WHEN `org` = 'log' THEN `gps_time`
-			END AS `ordertime`,
-			MAX(`org`) as `org`
-			FROM `position`
-			WHERE ((
+		$where = "((
 				" . intval($from) . " <= `rxtime`
 				AND `rxtime` <= " . intval($to) . "
 				AND `org` = 'pos'
@@ -101,10 +96,68 @@ class Tracker {
 				AND `gps_time` <= " . intval($to) . "
 				AND `org` = 'log'
 			))
-			AND `call` = '" . Database::getInstance()->escape_string($this->call) . "'
+			AND `call` = '" . Database::getInstance()->escape_string($this->call) . "'";
+
+		if($buckets > 0) {
+			$size = max(1, (int)ceil(($to - $from) / $buckets));
+			return $this->queryTelemetry("
+				SELECT `call`,MAX(`reset`) as `reset`,MAX(`id`) as `id`,MAX(`org`) as `org`,
+				MAX(`rxtime`) as `rxtime`,MAX(`gps_time`) as `gps_time`,MAX(`ordertime`) as `ordertime`,
+				AVG(`adc_vsol`) as `adc_vsol`,AVG(`adc_vbat`) as `adc_vbat`,AVG(`pac_vsol`) as `pac_vsol`,
+				AVG(`pac_vbat`) as `pac_vbat`,AVG(`pac_pbat`) as `pac_pbat`,AVG(`pac_psol`) as `pac_psol`,
+				MIN(`gps_lock`) as `gps_lock`,AVG(`gps_sats`) as `gps_sats`,AVG(`gps_ttff`) as `gps_ttff`,
+				AVG(`gps_pdop`) as `gps_pdop`,AVG(IF(`gps_lock` < 2,`gps_alt`,NULL)) as `gps_alt`,
+				AVG(NULLIF(`gps_lat`,0)) as `gps_lat`,AVG(NULLIF(`gps_lon`,0)) as `gps_lon`,
+				AVG(`sen_i1_press`) as `sen_i1_press`,AVG(`sen_e1_press`) as `sen_e1_press`,AVG(`sen_e2_press`) as `sen_e2_press`,
+				AVG(`sen_i1_temp`) as `sen_i1_temp`,AVG(`sen_e1_temp`) as `sen_e1_temp`,AVG(`sen_e2_temp`) as `sen_e2_temp`,
+				AVG(`sen_i1_hum`) as `sen_i1_hum`,AVG(`sen_e1_hum`) as `sen_e1_hum`,AVG(`sen_e2_hum`) as `sen_e2_hum`,
+				AVG(`stm32_temp`) as `stm32_temp`,AVG(`si4464_temp`) as `si4464_temp`,
+				AVG(`light_intensity`) as `light_intensity`,MAX(`sys_time`) as `sys_time`,BIT_OR(`sys_error`) as `sys_error`
+				FROM (
+					SELECT *,
+					CASE
+						WHEN `org` = 'pos' THEN `rxtime`
+						WHEN `org` = 'log' THEN `gps_time`
+					END AS `ordertime`
+					FROM `position`
+					WHERE " . $where . "
+				) AS t
+				GROUP BY t.`ordertime` DIV " . $size . "
+				ORDER BY MAX(t.`ordertime`) ASC
+			");
+		}
+
+		return $this->queryTelemetry("
+			SELECT *,
+			CASE
+				WHEN `org` = 'pos' THEN `rxtime`
+				WHEN `org` = 'log' THEN `gps_time`
+			END AS `ordertime`,
+			MAX(`org`) as `org`
+			FROM `position`
+			WHERE " . $where . "
 			GROUP BY `reset`,`id`
 			ORDER BY `ordertime` ASC
 		");
+	}
+	/* Returns the datasets received since $rxtime (log datasets included, whatever time they were recorded) */
+	function getTelemetrySince($rxtime) {
+		return $this->queryTelemetry("
+			SELECT *,
+			CASE
+				WHEN `org` = 'pos' THEN `rxtime`
+				WHEN `org` = 'log' THEN `gps_time`
+			END AS `ordertime`,
+			MAX(`org`) as `org`
+			FROM `position`
+			WHERE `call` = '" . Database::getInstance()->escape_string($this->call) . "'
+			AND `rxtime` >= " . intval($rxtime) . "
+			GROUP BY `reset`,`id`
+			ORDER BY `ordertime` ASC
+		");
+	}
+	private function queryTelemetry($sql) {
+		$query = Database::getInstance()->query($sql);
 
 		$datasets = array();
 		while($row = $query->fetch_assoc()) {
@@ -114,40 +167,21 @@ class Tracker {
 		return $datasets;
 	}
 	function getPacketCount() {
-		$query = Database::getInstance()->query("SELECT *
-			FROM (
-				SELECT COUNT(*) as `cnt86400`,'pos' as `type` FROM `position` WHERE `call` = '" . Database::getInstance()->escape_string($this->call) . "' AND `org` = 'pos' AND `rxtime`+86400 > UNIX_TIMESTAMP()
-				UNION ALL
-				SELECT COUNT(*) as `cnt86400`,'dir' as `type` FROM `directs` WHERE `call` = '" . Database::getInstance()->escape_string($this->call) . "' AND `rxtime`+86400 > UNIX_TIMESTAMP()
-				UNION ALL
-				SELECT COUNT(*) as `cnt86400`,'img' as `type` FROM `image` WHERE `call` = '" . Database::getInstance()->escape_string($this->call) . "' AND `rxtime`+86400 > UNIX_TIMESTAMP()
-				UNION ALL
-				SELECT COUNT(*) as `cnt86400`,'log' as `type` FROM `position` WHERE `call` = '" . Database::getInstance()->escape_string($this->call) . "' AND `org` = 'log' AND `rxtime`+86400 > UNIX_TIMESTAMP()
-			) AS a
-			JOIN (
-				SELECT COUNT(*) as `cnt3600`,'pos' as `type` FROM `position` WHERE `call` = '" . Database::getInstance()->escape_string($this->call) . "' AND `org` = 'pos' AND `rxtime`+3600 > UNIX_TIMESTAMP()
-				UNION ALL
-				SELECT COUNT(*) as `cnt3600`,'dir' as `type` FROM `directs` WHERE `call` = '" . Database::getInstance()->escape_string($this->call) . "' AND `rxtime`+3600 > UNIX_TIMESTAMP()
-				UNION ALL
-				SELECT COUNT(*) as `cnt3600`,'img' as `type` FROM `image` WHERE `call` = '" . Database::getInstance()->escape_string($this->call) . "' AND `rxtime`+3600 > UNIX_TIMESTAMP()
-				UNION ALL
-				SELECT COUNT(*) as `cnt3600`,'log' as `type` FROM `position` WHERE `call` = '" . Database::getInstance()->escape_string($this->call) . "' AND `org` = 'log' AND `rxtime`+3600 > UNIX_TIMESTAMP()
-			) AS b
-			JOIN (
-				SELECT COUNT(*) as `cnt300`,'pos' as `type` FROM `position` WHERE `call` = '" . Database::getInstance()->escape_string($this->call) . "' AND `org` = 'pos' AND `rxtime`+300 > UNIX_TIMESTAMP()
-				UNION ALL
-				SELECT COUNT(*) as `cnt300`,'dir' as `type` FROM `directs` WHERE `call` = '" . Database::getInstance()->escape_string($this->call) . "' AND `rxtime`+300 > UNIX_TIMESTAMP()
-				UNION ALL
-				SELECT COUNT(*) as `cnt300`,'img' as `type` FROM `image` WHERE `call` = '" . Database::getInstance()->escape_string($this->call) . "' AND `rxtime`+300 > UNIX_TIMESTAMP()
-				UNION ALL
-				SELECT COUNT(*) as `cnt300`,'log' as `type` FROM `position` WHERE `call` = '" . Database::getInstance()->escape_string($this->call) . "' AND `org` = 'log' AND `rxtime`+300 > UNIX_TIMESTAMP()
-			) AS c
-			WHERE a.`type` = b.`type`
-			AND a.`type` = c.`type`
+		// Counted per minute by the decoder, so the windows are accurate to one minute
+		$query = Database::getInstance()->query("
+			SELECT `type`,
+				SUM(`count`) as `cnt86400`,
+				SUM(IF(`minute` >= (UNIX_TIMESTAMP()-3600) DIV 60, `count`, 0)) as `cnt3600`,
+				SUM(IF(`minute` >= (UNIX_TIMESTAMP()-300) DIV 60, `count`, 0)) as `cnt300`
+			FROM `activity`
+			WHERE `call` = '" . Database::getInstance()->escape_string($this->call) . "'
+			AND `minute` >= (UNIX_TIMESTAMP()-86400) DIV 60
+			GROUP BY `type`
 		");
 
-
 		$ret = array();
+		foreach(array('pos', 'dir', 'img', 'log') as $type)
+			$ret[$type] = array('cnt86400' => 0, 'cnt3600' => 0, 'cnt300' => 0, 'type' => $type);
 		while($row = $query->fetch_assoc())
 			$ret[$row['type']] = $row;
 
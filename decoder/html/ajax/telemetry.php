@@ -7,9 +7,17 @@ require_once "../Tracker.class.php";
 
 header("Content-Type: application/json");
 $tracker = new Tracker($_GET['call']);
+if(isset($_GET['since'])) { // Live update, everything received since the last request
+	$telemetry = $tracker->getTelemetrySince($_GET['since']);
+	$images = $tracker->getPictures($_GET['since']);
+} else { // Whole window, downsampled to the chart width if given
+	$telemetry = $tracker->getTelemetry($_GET['from'], NULL, intval($_GET['width']));
+	$images = $tracker->getPictures($_GET['from']);
+}
 echo json_encode(array(
-	"telemetry"    => $tracker->getTelemetry($_GET['from']),
-	"images"       => $tracker->getPictures($_GET['from']),
+	"telemetry"    => $telemetry,
+	"last"         => $tracker->getLastTelemetry(),
+	"images"       => $images,
 	"lastActivity" => $tracker->getLastActivity(),
 	"packetCount"  => $tracker->getPacketCount(),
 	"time"         => time()
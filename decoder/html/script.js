@@ -12,6 +12,7 @@ var scroll = {axis: 'horizontal', keepInBounds: true, maxZoomIn: 20.0};
 var lastChartUpdate = 0;
 var last = null;
 var init = false;
+var loaded = false;
 
 // Chart 1
 var batteryChart;
@@ -387,16 +388,24 @@ function updateData() {
 		init = true;
 	}
 
-	$.getJSON("ajax/telemetry.php?call=" + call + "&from=" + lastrxtime, function(json) {
+	// Load the whole range once (one averaged dataset per pixel of the charts), then only new datasets
+	var url = "ajax/telemetry.php?call=" + call;
+	url += loaded ? "&since=" + lastrxtime : "&from=" + lastrxtime + "&width=" + $('#batteryDiv').width();
+
+	$.getJSON(url, function(json) {
+		loaded = true;
 
 		images = json['images'];
 		tel = json['telemetry'];
 
 		// Update telemetry
 		if(tel.length) {
-			lastrxtime = tel[tel.length-1].rxtime+1;
+			$.each(tel, function(key, data) {
+				if(data['rxtime'] >= lastrxtime)
+					lastrxtime = data['rxtime']+1;
+			});
 
-			$.each(tel[tel.length-1], function(key, d) {
+			$.each(json['last'], function(key, d) {
 				switch(key) {
 
 					case 'sen_i1_press':
@@ -596,7 +605,7 @@ function updateData() {
 			lastValidGPSalt = null;
 			$.each(tel, function(key, data) {
 
-				var time = new Date(data['org'] == 'pos' ? data['rxtime']*1000 : data['gps_time']*1000);
+				var time = new Date(data['ordertime']*1000);
 
 				if(last != null && (time - last > range*1000/60 && time - last > 300000 || time <= last)) { // Gap in the data set
 					if(dataBattery) dataBattery.addRow([null, null, null, null]);
@@ -700,9 +709,11 @@ function updateData() {
 				// Remove old div
 				$("#img_" + data['id']).remove();
 
-				// Process images
+				// Process images (the packet count tells the browser whether its cached copy is outdated)
+				var file = "images/" + data['call'].replace('-','') + "-" + data['id'];
 				$('#images').prepend("<div class=\"pic\" id=\"img_" + data['id'] + "\">"
-				 + "<img src=\"images/" + data['call'].replace('-','') + "-" + data['id'] + ".jpg?packetID=" + data['packetID'] + "\"><br>"
+				 + (data['thumb'] ? "<a href=\"" + file + ".jpg?count=" + data['count'] + "\"><img src=\"" + file + ".thumb.jpg?count=" + data['count'] + "\"></a><br>"
+				                  : "<img src=\"" + file + ".jpg?count=" + data['count'] + "\"><br>")
 				 + "Last packet " + time_format(json['time']-data['time_last']) + ", " + number_format(data['count']) + " packets, "
 				 + number_format(data['packetID']-data['count']+1) + " lost" + "<br>ImageID " + number_format(data['imageID']) + ", ServerID "
 				 + number_format(data['id']) + "</div>");
@@ -710,7 +721,7 @@ function updateData() {
 
 			data = images[images.length-1];
 			$('#image').html("<a href=\"images.php?call=" + data['call'] + "\">"
-				+ "<img src=\"images/" + images[images.length-1]['call'].replace('-','') + "-" + images[images.length-1]['id'] + ".jpg?packetID=" + data['packetID'] + "\"></a>");
+				+ "<img src=\"images/" + data['call'].replace('-','') + "-" + data['id'] + (data['thumb'] ? ".thumb" : "") + ".jpg?count=" + data['count'] + "\"></a>");
 		}
 
 	});
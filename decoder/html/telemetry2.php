@@ -9,6 +9,7 @@ range = <?=$range?>;
 call = '<?=$_GET['call']?>';
 var last = null;
 var lastChartUpdate = 0;
+var loaded = false;
 
 const COL_GREEN		= "#008000";
 const COL_ORANGE	= "#CC6600";
@@ -78,12 +79,20 @@ function get_alt(p) {
 
 function loadRecentData() {
 
-	$.getJSON("ajax/telemetry.php?call=" + call + "&from=" + lastrxtime, function(json) {
+	// Load the whole range once (one averaged dataset per pixel of the charts), then only new datasets
+	var url = "ajax/telemetry.php?call=" + call;
+	url += loaded ? "&since=" + lastrxtime : "&from=" + lastrxtime + "&width=" + $('#batteryDiv').width();
+
+	$.getJSON(url, function(json) {
+		loaded = true;
 		tel = json['telemetry'];
 		if(tel.length) {
-			lastrxtime = tel[tel.length-1].rxtime+1;
+			$.each(tel, function(key, data) {
+				if(data['rxtime'] >= lastrxtime)
+					lastrxtime = data['rxtime']+1;
+			});
 
-			$.each(tel[tel.length-1], function(key, d) {
+			$.each(json['last'], function(key, d) {
 				switch(key) {
 
 					case 'sen_i1_press':
@@ -266,7 +275,7 @@ function loadRecentData() {
 
 			$.each(tel, function(key, data) {
 
-				var time = new Date(data['org'] == 'pos' ? data['rxtime']*1000 : data['gps_time']*1000);
+				var time = new Date(data['ordertime']*1000);
 
 				if(last != null && time - last > range*1000/60) { // Gap in the data set
 					dataBattery.addRow([null, null, null, null]);
@@ -2,11 +2,16 @@ import binascii
 import urllib.request
 import urllib.error
 from datetime import datetime
-from subprocess import *
 import time
+import os
 import threading
-from shutil import copyfile
 import base91
+import ssdvdec
+from position import count_activity
+try:
+	from PIL import Image # Optional, thumbnails are not generated without it
+except ImportError:
+	Image = None
 
 def decode_callsign(code):
 	callsign = ''
@@ -33,43 +38,65 @@ def encode_callsign(callsign):
 	return x
 
 imageProcessor = None
-imageData = {}
-imageDataLcl = {}
+images = {} # Server image ID => (call, decoder, last update)
+updated = set() # Server image IDs with new packets since the last JPEG
+rendered = {} # Server image ID => (packet count of the JPEG written, time)
 lock = threading.RLock()
 
-def imgproc():
-	global imageData
+THUMB_SIZE = (320, 240)
+
+""" Replaces a file at once, so the web server never delivers a partly written image """
+def write_file(filename, data):
+	with open(filename + '.tmp', 'wb') as f:
+		f.write(data)
+	os.replace(filename + '.tmp', filename)
 
+def imgproc():
 	while True:
-		imageDataCpy = {}
+		jobs = []
+		done = []
 		with lock:
-			imageDataCpy = imageData
-			imageData = {} # Clear data
-
-		for _id in imageDataCpy:
-			(call, data) = imageDataCpy[_id]
-			filename = 'html/images/%s-%d.jpg' % (call.replace('-',''), _id)
-			f = open(filename, 'wb')
-			process = Popen(['./ssdv', '-d'], stdin=PIPE, stdout=f, stderr=PIPE)
-			process.stdin.write(data)
-			dummy,err = process.communicate()
-			f.close()
-
-			filename2 = 'html/images/%s.jpg' % (call.replace('-',''))
-			copyfile(filename, filename2)
+			for _id in updated:
+				(call, decoder, last) = images[_id]
+				count = len(decoder.packets)
+				if _id not in rendered or rendered[_id][0] != count: # Only re-render if packets were added
+					jobs.append((call, _id, decoder.jpeg()))
+					rendered[_id] = (count, time.time())
+			updated.clear()
+
+			# Forget images which don't receive packets anymore, they get their thumbnail now
+			for _id in [_id for _id in images if images[_id][2]+5*60 < time.time()]:
+				done.append((images[_id][0], _id))
+				del images[_id]
+			for _id in [_id for _id in rendered if rendered[_id][1]+86400 < time.time()]:
+				del rendered[_id]
+
+		for (call, _id, jpeg) in jobs:
+			write_file('html/images/%s-%d.jpg' % (call.replace('-',''), _id), jpeg)
+			write_file('html/images/%s.jpg' % (call.replace('-','')), jpeg)
+
+		if Image is not None:
+			for (call, _id) in done:
+				filename = 'html/images/%s-%d' % (call.replace('-',''), _id)
+				try:
+					with Image.open(filename + '.jpg') as img:
+						img.thumbnail(THUMB_SIZE)
+						img.save(filename + '.thumb.jpg.tmp', 'JPEG')
+					os.replace(filename + '.thumb.jpg.tmp', filename + '.thumb.jpg')
+				except OSError:
+					pass
 
 		time.sleep(1)
 
-w = time.time()
-def insert_image(db, receiver, call, data_b91):
-	global imageProcessor,imageData,imageDataLcl,w
+serverIDs = {} # (call, image ID) => (server image ID, last rxtime)
+
+def insert_image(batch, receiver, call, data_b91):
+	global imageProcessor
 
 	data = base91.decode(data_b91)
 	if len(data) != 174:
 		return # APRS message has invalid type or length (or both)
 
-	cur = db.cursor()
-
 	# Decode various meta data
 	imageID  = data[0]
 	packetID = (data[1] << 8) | data[2]
@@ -93,47 +120,90 @@ def insert_image(db, receiver, call, data_b91):
 
 	# Find image ID (or generate new one)
 	_id = None
-	cur.execute("SELECT `id`,`packetID` FROM `image` WHERE `call` = %s AND `imageID` = %s AND `rxtime`+5*60 >= %s ORDER BY `rxtime` DESC LIMIT 1", (call, imageID, timd))
-	fetch = cur.fetchall()
-	if len(fetch):
-		_id = fetch[0][0]
-		lastPacketId = fetch[0][1]
+	key = (call, imageID)
+	if key in serverIDs:
+		if serverIDs[key][1]+5*60 >= timd:
+			_id = serverIDs[key][0]
+	else: # Not seen since start, the image may be in the database already
+		fetch = batch.query("SELECT `id` FROM `image` WHERE `call` = %s AND `imageID` = %s AND `rxtime` >= %s ORDER BY `rxtime` DESC LIMIT 1", (call, imageID, timd-5*60))
+		if len(fetch):
+			_id = fetch[0][0]
 
 	if _id is None:
 		# Generate ID
-		cur.execute("SELECT `id`+1 FROM `image` ORDER BY `id` DESC LIMIT 1")
-		fetch = cur.fetchall()
-		if len(fetch):
-			_id = fetch[0][0]
-		else: # No entries in the database
-			_id = 0
+		_id = batch.execute("INSERT INTO `images` (`call`,`imageID`,`rxtime`) VALUES (%s,%s,%s)", (call, imageID, timd))
+	serverIDs[key] = (_id, timd)
 
 	# Debug
 	print('Received image packet Call=%s ImageID=%d PacketID=%d ServerID=%d' % (call, imageID, packetID, _id))
 
-	# Insert into database
-	cur.execute("""
+	# Insert into database, packets received twice (e.g. through several receivers) are counted once
+	if batch.modify("""
 		INSERT IGNORE INTO `image` (`call`,`rxtime`,`imageID`,`packetID`,`data`,`id`)
 		VALUES (%s,%s,%s,%s,%s,%s)""",
 		(call, timd, imageID, packetID, data, _id)
-	)
-
-	if w+1 < time.time():
-		db.commit()
-		with lock:
-			imageData = imageDataLcl
-			imageDataLcl = {}
-		w = time.time()
-
-	allData = ''
-
-	cur.execute("SELECT `data` FROM `image` WHERE `id` = %s ORDER BY `packetID`", (_id,))
-	for data, in cur.fetchall():
-		allData += '55' + data + (144*'0')
-
-	imageDataLcl[_id] = (call, binascii.unhexlify(allData))
+	):
+		count_activity(batch, call, 'img', timd)
+
+	with lock:
+		if _id in images:
+			decoder = images[_id][1]
+		else: # Continue with the packets already stored
+			decoder = ssdvdec.Decoder()
+			for pID, pData in batch.query("SELECT `packetID`,`data` FROM `image` WHERE `id` = %s", (_id,)):
+				decoder.add(pID, binascii.unhexlify('55' + pData))
+			updated.add(_id)
+
+		if decoder.add(packetID, binascii.unhexlify('55' + data)):
+			updated.add(_id)
+		images[_id] = (call, decoder, time.time())
 
 	if imageProcessor is None:
 		imageProcessor = threading.Thread(target=imgproc)
 		imageProcessor.start()
 
+""" Builds selective repeat requests (NACK) for the gaps of the latest image with this image ID.
+Each request covers a window of packets as bitmap, so it fits into one APRS message.
+Packets missing after the last received packet are not known and can't be requested.
+In preview only mode the tracker sends the first and last packet of the image it holds,
+a region of that image is requested by limiting the gaps to the packets first to last. """
+def nack_requests(db, call, imageID, window=192, first=0, last=None):
+	cur = db.cursor()
+	cur.execute("SELECT `id` FROM `image` WHERE `call` = %s AND `imageID` = %s ORDER BY `rxtime` DESC LIMIT 1", (call, imageID))
+	fetch = cur.fetchall()
+	if not len(fetch):
+		return []
+
+	cur.execute("SELECT `packetID` FROM `image` WHERE `id` = %s", (fetch[0][0],))
+	received = set(packetID for packetID, in cur.fetchall())
+	end = max(received) if last is None else min(last + 1, max(received))
+	missing = [p for p in range(first, end) if p not in received]
+
+	requests = []
+	while len(missing):
+		base = missing[0]
+		bits = [p - base for p in missing if p < base + window]
+		missing = missing[len(bits):]
+
+		bitmap = 0
+		digits = bits[-1] // 4 + 1
+		for b in bits:
+			bitmap |= 1 << (digits*4 - 1 - b)
+		requests.append('?img nack %02x%04x %0*x' % (imageID, base, digits, bitmap))
+
+	return requests
+
+if __name__ == '__main__':
+	import argparse
+	import mysql.connector as mariadb
+
+	parser = argparse.ArgumentParser(description='Generates APRS messages requesting the missing packets of an image')
+	parser.add_argument('call', help='Callsign of the tracker (e.g. DL7AD-12)')
+	parser.add_argument('imageID', help='Image ID sent by the tracker', type=int)
+	parser.add_argument('--first', help='First packet of the region to request', type=int, default=0)
+	parser.add_argument('--last', help='Last packet of the region to request', type=int, default=None)
+	args = parser.parse_args()
+
+	db = mariadb.connect(user='decoder', password='decoder', database='decoder')
+	for request in nack_requests(db, args.call, args.imageID, first=args.first, last=args.last):
+		print(':%-9s:%s' % (args.call, request))
@@ -0,0 +1,200 @@
+import selectors
+import socket
+import sys
+import time
+import serial
+
+""" Packet sources of the decoder. Each source delivers APRS packets as TNC2 text lines
+(CALL>DEST,PATH:info) and is read by one event loop together with the other sources. """
+
+RECONNECT = 10 # Seconds to wait before a lost source is reopened
+
+""" Splits a byte stream into text lines """
+class Lines:
+	def __init__(self):
+		self.buf = b''
+
+	def feed(self, data):
+		self.buf += data
+		lines = self.buf.replace(b'\r', b'\n').split(b'\n')
+		self.buf = lines.pop()
+		return [l.decode('charmap') for l in lines if len(l)]
+
+class Source:
+	def __init__(self, name):
+		self.name = name
+		self.lines = Lines()
+		self.wdg = None # Watchdog, the source is reopened when it expires
+
+	def open(self):
+		pass
+
+	def close(self):
+		pass
+
+	def expired(self):
+		return self.wdg is not None and self.wdg < time.time()
+
+class AprsIs(Source):
+	def __init__(self, call, host='euro.aprs2.net', port=14580):
+		Source.__init__(self, 'APRS-IS')
+		self.call = call
+		self.addr = (host, port)
+
+	def open(self):
+		self.sock = socket.create_connection(self.addr, 3)
+		self.sock.sendall(("user %s filter u/APECAN\n" % self.call).encode('ascii'))
+		self.wdg = time.time() + 10
+
+	def close(self):
+		self.sock.close()
+
+	def fileno(self):
+		return self.sock.fileno()
+
+	def read(self):
+		data = self.sock.recv(4096)
+		if not len(data): # Server has connection closed
+			raise ConnectionError('connection closed')
+		lines = []
+		for line in self.lines.feed(data):
+			if line.startswith('#'):
+				if '# aprsc' in line: # Watchdog reload
+					self.wdg = time.time() + 30
+			else:
+				lines.append(line)
+		return lines
+
+class SerialTnc(Source):
+	def __init__(self, port, baudrate):
+		Source.__init__(self, port)
+		self.port = port
+		self.baudrate = baudrate
+
+	def open(self):
+		self.ser = serial.Serial(port=self.port, baudrate=self.baudrate, timeout=0)
+
+	def close(self):
+		self.ser.close()
+
+	def fileno(self):
+		return self.ser.fileno()
+
+	def read(self):
+		return self.lines.feed(self.ser.read(max(self.ser.in_waiting, 1)))
+
+class Stdin(Source):
+	def __init__(self):
+		Source.__init__(self, 'stdin')
+
+	def fileno(self):
+		return sys.stdin.fileno()
+
+	def read(self):
+		data = sys.stdin.buffer.read1(4096)
+		if not len(data):
+			raise EOFError('end of input')
+		return self.lines.feed(data)
+
+""" KISS over TCP (e.g. the KISS port of Dire Wolf), AX.25 frames are converted into TNC2 lines """
+class KissTcp(Source):
+	FEND, FESC, TFEND, TFESC = 0xC0, 0xDB, 0xDC, 0xDD
+
+	def __init__(self, host, port):
+		Source.__init__(self, 'kiss:%s:%d' % (host, port))
+		self.addr = (host, port)
+		self.buf = b''
+
+	def open(self):
+		self.sock = socket.create_connection(self.addr, 3)
+		self.buf = b''
+
+	def close(self):
+		self.sock.close()
+
+	def fileno(self):
+		return self.sock.fileno()
+
+	@staticmethod
+	def address(data):
+		call = ''.join(chr(c >> 1) for c in data[:6]).strip()
+		ssid = (data[6] >> 1) & 0x0F
+		return call + ('-%d' % ssid if ssid else '')
+
+	@staticmethod
+	def tnc2(frame):
+		addrs = []
+		i = 0
+		while i+7 <= len(frame):
+			addrs.append(frame[i:i+7])
+			i += 7
+			if frame[i-1] & 0x01: # Last address
+				break
+		if len(addrs) < 2 or frame[i:i+2] != b'\x03\xf0': # Only UI frames carry APRS
+			return None
+		path = [KissTcp.address(a) + ('*' if a[6] & 0x80 else '') for a in addrs[2:]]
+		head = KissTcp.address(addrs[1]) + '>' + ','.join([KissTcp.address(addrs[0])] + path)
+		return head + ':' + frame[i+2:].decode('charmap')
+
+	def read(self):
+		data = self.sock.recv(4096)
+		if not len(data):
+			raise ConnectionError('connection closed')
+		frames = (self.buf + data).split(bytes([self.FEND]))
+		self.buf = frames.pop()
+		lines = []
+		for frame in frames:
+			if len(frame) < 2 or frame[0] & 0x0F != 0: # Data frames only
+				continue
+			frame = frame[1:].replace(bytes([self.FESC, self.TFEND]), bytes([self.FEND])) \
+			                 .replace(bytes([self.FESC, self.TFESC]), bytes([self.FESC]))
+			line = self.tnc2(frame)
+			if line is not None:
+				lines.append(line)
+		return lines
+
+""" Reads all sources and passes each received line to the handler """
+def run(sources, handler):
+	sel = selectors.DefaultSelector()
+	closed = {} # Source => time it may be reopened
+
+	def start(src):
+		try:
+			src.open()
+			sel.register(src, selectors.EVENT_READ)
+			print('Connected to %s' % src.name)
+		except Exception as e:
+			print('Could not open %s: %s' % (src.name, str(e)))
+			closed[src] = time.time() + RECONNECT
+
+	def stop(src, reason):
+		print('%s lost (%s)... reopen' % (src.name, reason))
+		sel.unregister(src)
+		try:
+			src.close()
+		except Exception:
+			pass
+		closed[src] = time.time()
+
+	for src in sources:
+		start(src)
+
+	while len(sel.get_map()) or len(closed):
+		for key, events in sel.select(timeout=1):
+			src = key.fileobj
+			try:
+				lines = src.read()
+			except EOFError: # Input is at its end, nothing to reopen
+				sel.unregister(src)
+				continue
+			except Exception as e:
+				stop(src, str(e))
+				continue
+			for line in lines:
+				handler(line)
+
+		for src in [key.fileobj for key in list(sel.get_map().values()) if key.fileobj.expired()]:
+			stop(src, 'watchdog')
+		for src in [src for src in closed if closed[src] <= time.time()]:
+			del closed[src]
+			start(src)
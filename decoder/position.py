@@ -1,8 +1,21 @@
 from datetime import datetime,timedelta,timezone
 import base91
 import struct
+import time
 
-def insert_position(db, call, comm, typ):
+""" Counts a packet in the per minute activity counters read by the web interface """
+def count_activity(batch, call, typ, rxtime):
+	batch.execute(
+		"""INSERT INTO `activity` (`call`,`type`,`minute`,`count`) VALUES (%s,%s,%s,1)
+			ON DUPLICATE KEY UPDATE `count`=`count`+1""",
+		(call, typ, rxtime // 60)
+	)
+
+""" Deletes the activity counters older than a day, the web interface shows the last 24 hours only """
+def purge_activity(batch):
+	batch.execute("DELETE FROM `activity` WHERE `minute` < %s", ((int(time.time()) - 86400) // 60,))
+
+def insert_position(batch, call, comm, typ):
 	try:
 		# Decode comment
 		data = base91.decode(comm)
@@ -14,7 +27,7 @@ def insert_position(db, call, comm, typ):
 
 		# Insert
 		rxtime = int(datetime.now(timezone.utc).timestamp())
-		db.cursor().execute(
+		batch.execute(
 			"""INSERT INTO `position` (`call`,`rxtime`,`org`,`adc_vsol`,`adc_vbat`,`pac_vsol`,`pac_vbat`,`pac_pbat`,`pac_psol`,`light_intensity`,`gps_lock`,
 				`gps_sats`,`gps_ttff`,`gps_pdop`,`gps_alt`,`gps_lat`,`gps_lon`,`sen_i1_press`,`sen_e1_press`,`sen_e2_press`,`sen_i1_temp`,`sen_e1_temp`,
 				`sen_e2_temp`,`sen_i1_hum`,`sen_e1_hum`,`sen_e2_hum`,`sys_error`,`stm32_temp`,`si4464_temp`,`reset`,`id`,`sys_time`,`gps_time`)
@@ -23,7 +36,7 @@ def insert_position(db, call, comm, typ):
 			 gps_pdop,gps_alt,gps_lat,gps_lon,sen_i1_press,sen_e1_press,sen_e2_press,sen_i1_temp,sen_e1_temp,sen_e2_temp,sen_i1_hum,
 			 sen_e1_hum,sen_e2_hum,sys_error,stm32_temp,si4464_temp,reset,_id,sys_time,gps_time)
 		)
-		db.commit()
+		count_activity(batch, call, typ, rxtime)
 
 		# Debug
 		print('Received %s packet packet Call=%s Reset=%d ID=%d' % (typ, call, reset, _id))
@@ -32,10 +45,10 @@ def insert_position(db, call, comm, typ):
 
 			print('Received erroneous %s packet Call=%s' % (typ, call))
 
-def insert_directs(db, call, dir):
+def insert_directs(batch, call, dir):
 	rxtime = int(datetime.now(timezone.utc).timestamp())
-	db.cursor().execute("INSERT INTO `directs` (`call`,`rxtime`,`directs`) VALUES (%s,%s,%s)", (call,rxtime,dir))
-	db.commit()
+	batch.execute("INSERT INTO `directs` (`call`,`rxtime`,`directs`) VALUES (%s,%s,%s)", (call,rxtime,dir))
+	count_activity(batch, call, 'dir', rxtime)
 
 	# Debug
 	print('Received dir packet packet Call=%s' % call)
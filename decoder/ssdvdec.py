@@ -0,0 +1,56 @@
+import ctypes
+import os
+
+""" Incremental SSDV decoder running the SSDV code of the tracker (build the library with make in ssdvdec/) """
+lib = ctypes.CDLL(os.path.join(os.path.dirname(os.path.abspath(__file__)), 'ssdvdec', 'libssdvdec.so'))
+lib.ssdvdec_new.restype = ctypes.c_void_p
+lib.ssdvdec_new.argtypes = [ctypes.c_size_t]
+lib.ssdvdec_free.argtypes = [ctypes.c_void_p]
+lib.ssdvdec_feed.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+lib.ssdvdec_get_jpeg.restype = ctypes.c_size_t
+lib.ssdvdec_get_jpeg.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_size_t]
+
+PKT_SIZE = 256
+BUF_SIZE = 1024*1024
+
+""" Decoder for one image. Packets are fed as they arrive. A packet older than the last one
+fed (e.g. a repeated packet) restarts the decoding with all packets when the JPEG is taken. """
+class Decoder:
+	def __init__(self):
+		self.packets = {}
+		self.last = -1
+		self.dec = None
+
+	def __del__(self):
+		if self.dec is not None:
+			lib.ssdvdec_free(self.dec)
+
+	def _restart(self):
+		if self.dec is not None:
+			lib.ssdvdec_free(self.dec)
+		self.dec = lib.ssdvdec_new(BUF_SIZE)
+		self.last = -1
+		for packetID in sorted(self.packets):
+			lib.ssdvdec_feed(self.dec, self.packets[packetID])
+			self.last = packetID
+
+	""" Adds a complete SSDV packet, returns False if the packet is known already """
+	def add(self, packetID, packet):
+		if packetID in self.packets:
+			return False
+		packet = packet.ljust(PKT_SIZE, b'\x00')
+		self.packets[packetID] = packet
+		if self.dec is not None and self.last is not None and packetID > self.last:
+			lib.ssdvdec_feed(self.dec, packet)
+			self.last = packetID
+		else:
+			self.last = None # Out of order, restart at next JPEG
+		return True
+
+	""" Returns the JPEG of the packets received so far """
+	def jpeg(self):
+		if self.dec is None or self.last is None:
+			self._restart()
+		buf = ctypes.create_string_buffer(BUF_SIZE)
+		length = lib.ssdvdec_get_jpeg(self.dec, buf, BUF_SIZE)
+		return buf.raw[:length]
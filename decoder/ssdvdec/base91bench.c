@@ -0,0 +1,153 @@
+/*
+ * basE91 benchmark and round trip check of the tracker encoder.
+ * Random and all-zero buffers of many lengths are encoded in random chunk
+ * sizes with base91_put/base91_end. The tool checks that the chunked output
+ * equals the output of base91_encode and fits into BASE91LEN, and writes
+ * the test vectors to a file. base91check.py then checks the vectors
+ * against the decoder of the ground station (decoder/base91.py).
+ * The encoder throughput is reported for SSDV sized payloads.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "base91.h"
+
+#define MAX_LEN		4096
+#define SSDV_PAYLOAD	174		/* Payload the image thread encodes per packet */
+#define BENCH_SIZE	(1024*1024)
+
+static const size_t lengths[] = {255, 256, 257, 1000, 4095, MAX_LEN};
+#define NUM_LENGTHS (sizeof(lengths)/sizeof(lengths[0]))
+
+static int failed;
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Encodes in random chunk sizes (empty chunks included), returns the output length */
+static size_t encode_chunked(base91_t *b, const uint8_t *in, size_t len, uint8_t *out)
+{
+	size_t n = 0;
+	while(len) {
+		size_t r = rand() % (len + 1);
+		n += base91_put(b, in, r, out + n);
+		in += r;
+		len -= r;
+	}
+	return n + base91_end(b, out + n);
+}
+
+/* Checks one buffer and writes its test vector, the handle is reused to check the reset */
+static void check(FILE *vec, base91_t *b, const uint8_t *in, size_t len, const char *kind)
+{
+	static uint8_t ref[BASE91LEN(MAX_LEN)+1];
+	static uint8_t out[BASE91LEN(MAX_LEN)+1];
+
+	size_t ref_len = base91_encode(in, ref, len);
+	size_t out_len = encode_chunked(b, in, len, out);
+
+	if(ref_len > BASE91LEN(len)) {
+		printf("FAIL %s %zu: %zu bytes exceed BASE91LEN\n", kind, len, ref_len);
+		failed++;
+	}
+	if(out_len != ref_len || memcmp(out, ref, ref_len)) {
+		printf("FAIL %s %zu: chunked output differs from base91_encode\n", kind, len);
+		failed++;
+	}
+
+	fprintf(vec, "%s %zu ", kind, len);
+	for(size_t i = 0; i < len; i++)
+		fprintf(vec, "%02x", in[i]);
+	fprintf(vec, " %.*s\n", (int)out_len, out);
+}
+
+/* Checks a random and an all-zero buffer of the length */
+static int round_trips(FILE *vec, base91_t *b, size_t len)
+{
+	static uint8_t rnd[MAX_LEN];
+	static const uint8_t zero[MAX_LEN];
+
+	for(size_t i = 0; i < len; i++)
+		rnd[i] = rand();
+	check(vec, b, rnd, len, "random");
+	check(vec, b, zero, len, "zero");
+	return 2;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "Usage: %s [-o file] [-r runs] [-s seed]\n"
+		"  -o file  test vectors for base91check.py (default base91.vec)\n"
+		"  -r runs  passes over %d kB for the timing (default 10)\n"
+		"  -s seed  seed of the random buffers and chunk sizes\n", name, BENCH_SIZE / 1024);
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	const char *file = "base91.vec";
+	int runs = 10;
+	unsigned int seed = 1;
+	int opt;
+
+	while((opt = getopt(argc, argv, "o:r:s:")) != -1) {
+		switch(opt) {
+			case 'o': file = optarg; break;
+			case 'r': runs = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+			case 's': seed = strtoul(optarg, NULL, 0); break;
+			default: usage(argv[0]);
+		}
+	}
+	if(optind != argc)
+		usage(argv[0]);
+	srand(seed);
+
+	FILE *vec = fopen(file, "w");
+	if(vec == NULL) {
+		perror(file);
+		return 1;
+	}
+
+	/* Round trips, all lengths up to two SSDV payloads and some larger ones */
+	base91_t b;
+	int cases = 0;
+
+	base91_init(&b);
+	for(size_t len = 0; len <= 2*SSDV_PAYLOAD; len++)
+		cases += round_trips(vec, &b, len);
+	for(size_t i = 0; i < NUM_LENGTHS; i++)
+		cases += round_trips(vec, &b, lengths[i]);
+	fclose(vec);
+
+	/* Throughput, the payloads are encoded one by one like in the image thread */
+	static uint8_t in[BENCH_SIZE];
+	static uint8_t out[BASE91LEN(SSDV_PAYLOAD)];
+	size_t out_bytes = 0;
+	for(size_t i = 0; i < BENCH_SIZE; i++)
+		in[i] = rand();
+
+	double t0 = now();
+	for(int r = 0; r < runs; r++) {
+		for(size_t i = 0; i + SSDV_PAYLOAD <= BENCH_SIZE; i += SSDV_PAYLOAD) {
+			size_t n = base91_put(&b, &in[i], SSDV_PAYLOAD, out);
+			out_bytes += n + base91_end(&b, out + n);
+		}
+	}
+	double t1 = now();
+	double payloads = (double)(BENCH_SIZE / SSDV_PAYLOAD) * runs;
+
+	printf("%d round trips written to %s\n", cases, file);
+	printf("Encoder %.0f kB/s, %.0f payloads/s of %d bytes (%.3f output bytes per input byte)\n",
+		payloads * SSDV_PAYLOAD / (t1 - t0) / 1e3, payloads / (t1 - t0), SSDV_PAYLOAD,
+		out_bytes / (payloads * SSDV_PAYLOAD));
+	printf("%s (%d failed)\n", failed ? "FAILED" : "OK", failed);
+	return failed ? 1 : 0;
+}
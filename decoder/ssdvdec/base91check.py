@@ -0,0 +1,31 @@
+import os
+import sys
+
+""" Checks the test vectors of base91bench against the basE91 code of the ground station """
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..'))
+import base91
+
+if len(sys.argv) != 2:
+	print('Usage: %s base91.vec' % sys.argv[0])
+	sys.exit(2)
+
+cases = 0
+failed = 0
+with open(sys.argv[1]) as f:
+	for line in f:
+		kind, length, data, encoded = line.rstrip('\n').split(' ')
+		data = bytes.fromhex(data)
+		cases += 1
+		if len(data) != int(length):
+			print('FAIL %s %s: broken test vector' % (kind, length))
+			failed += 1
+		elif base91.encode(data) != encoded:
+			print('FAIL %s %s: differs from base91.encode' % (kind, length))
+			failed += 1
+		elif bytes(base91.decode(encoded)) != data:
+			print('FAIL %s %s: base91.decode does not return the input' % (kind, length))
+			failed += 1
+
+print('%d round trips checked against base91.py' % cases)
+print('%s (%d failed)' % ('FAILED' if failed else 'OK', failed))
+sys.exit(1 if failed else 0)
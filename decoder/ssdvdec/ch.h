@@ -0,0 +1,25 @@
+#ifndef __CH_H__
+#define __CH_H__
+
+/* Host build of the tracker tools, only the standard types are needed */
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/* The system time is a millisecond counter the tool sets, mutexes do nothing */
+typedef uint32_t systime_t;
+typedef uint32_t sysinterval_t;
+typedef struct { int unused; } mutex_t;
+
+extern systime_t host_time;
+
+#define MUTEX_DECL(name)        mutex_t name
+#define chMtxLock(mp)           ((void)(mp))
+#define chMtxUnlock(mp)         ((void)(mp))
+#define chVTGetSystemTime()     (host_time)
+#define chTimeDiffX(start, end) ((sysinterval_t)((end) - (start)))
+#define TIME_S2I(secs)          ((sysinterval_t)(secs) * 1000)
+#define TIME_I2S(interval)      ((interval) / 1000)
+#define TIME_I2MS(interval)     (interval)
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef __CONFIG_H__
+#define __CONFIG_H__
+
+/* Host build of the tracker tools, the tool sets the configuration */
+#include "types.h"
+
+typedef struct {
+  power_conf_t      power;
+} conf_t;
+
+extern conf_t conf_sram;
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef __DEBUG_H__
+#define __DEBUG_H__
+
+/* Host build of the tracker code, trace output is not used (the arguments are still checked) */
+#include <stdio.h>
+
+#define TRACE_INFO(format, args...)	do { if(0) printf(format, ##args); } while(0)
+#define TRACE_ERROR(format, args...)	do { if(0) printf(format, ##args); } while(0)
+
+#endif
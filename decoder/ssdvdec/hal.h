@@ -0,0 +1,6 @@
+#ifndef __HAL_H__
+#define __HAL_H__
+
+/* Host build of the tracker tools, nothing of the HAL is used */
+
+#endif
@@ -0,0 +1,81 @@
+/*
+ * Check of the tracker state of charge integration (threads/power.c).
+ * A known charge/discharge trace is fed to power_update in the unit of the
+ * PAC1720 driver (0.1 mW) and the state of charge and transmit scale are
+ * compared with the values calculated by hand for the default configuration.
+ */
+
+#include <stdio.h>
+#include "power.h"
+#include "config.h"
+
+#define STEP		60		/* Collector cycle in seconds */
+#define VBAT_MID	3500		/* Battery voltage between the limits */
+
+systime_t host_time;
+
+conf_t conf_sram = {
+	.power = {
+		.enabled = true,
+		.capacity = 7400,	/* mWh, 26640000 mWs */
+		.vbat_empty = 3000,
+		.vbat_full = 4150,
+		.soc_min = 20,
+		.soc_nominal = 60,
+		.scale_min = 250,
+		.scale_max = 2000
+	}
+};
+
+static int failed;
+
+static void expect(const char *what, int value, int expected)
+{
+	printf("%-40s %6d %6d%s\n", what, value, expected, value == expected ? "" : "  FAIL");
+	if(value != expected)
+		failed++;
+}
+
+/* Feeds the battery power (in 0.1 mW) for the time at the collector cycle */
+static void run(int16_t pbat, uint16_t vbat, int secs)
+{
+	for(int t = 0; t < secs; t += STEP) {
+		host_time += TIME_S2I(STEP);
+		power_update(pbat, vbat);
+	}
+}
+
+int main(void)
+{
+	printf("%-40s %6s %6s\n", "", "value", "expect");
+
+	/* First update, the state of charge is taken from the voltage (half way) */
+	power_update(0, 3575);
+	expect("SoC from voltage", power_get_soc(), 50);
+	expect("scale at 50%", power_get_scale(), 250 + 750 * 30 / 40);
+
+	/* 1000 mW discharge for an hour takes 3600000 mWs (13.5%) */
+	run(-10000, VBAT_MID, 3600);
+	expect("SoC after 1 h at -1000 mW", power_get_soc(), 36);
+	/* Another hour at -1000 mW is predicted (22.6%) */
+	expect("scale predicted at -1000 mW", power_get_scale(), 250 + 750 * 2 / 40);
+
+	/* 2000 mW charge for half an hour brings it back */
+	run(20000, VBAT_MID, 1800);
+	expect("SoC after 0.5 h at +2000 mW", power_get_soc(), 50);
+	/* An hour at 2000 mW is predicted (77%) */
+	expect("scale predicted at +2000 mW", power_get_scale(), 1000 + 1000 * 17 / 40);
+
+	run(0, VBAT_MID, STEP);
+	expect("scale predicted at 0 mW", power_get_scale(), 250 + 750 * 30 / 40);
+
+	/* The voltage limits re-anchor the estimate */
+	run(0, 4150, STEP);
+	expect("SoC at full voltage", power_get_soc(), 100);
+	run(-10000, 3000, STEP);
+	expect("SoC at empty voltage", power_get_soc(), 0);
+	expect("scale at empty", power_get_scale(), 250);
+
+	printf("%s (%d failed)\n", failed ? "FAILED" : "OK", failed);
+	return failed ? 1 : 0;
+}
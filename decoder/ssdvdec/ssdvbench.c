@@ -0,0 +1,255 @@
+/*
+ * SSDV benchmark and conformance check of the tracker SSDV code.
+ * Every JPEG given is encoded at all qualities (0-7) and packet types and
+ * decoded back. The tool checks that
+ *  - all packet types of a quality decode to the same JPEG,
+ *  - FEC packets decode to the same JPEG with byte errors in every packet,
+ *  - the decoder survives random packet loss,
+ *  - the decoded JPEGs match the golden files of a previous run (-g, one
+ *    file per image and quality as all packet types decode the same).
+ * Encoder and decoder throughput is reported. The exit code is non zero if
+ * a check failed, so it can be run before a change to ssdv.c is flown.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "ssdv.h"
+
+#define MAX_JPEG	(4*1024*1024)
+#define MAX_PACKETS	8192
+#define FEED_SIZE	128		/* The tracker feeds the encoder in chunks as well */
+#define FEC_ERRORS	8		/* Byte errors per packet, the RS code corrects up to 16 */
+
+static const struct {
+	uint8_t type;
+	const char *name;
+} types[] = {
+	{SSDV_TYPE_NORMAL,	"fec"},
+	{SSDV_TYPE_NOFEC,	"nofec"},
+	{SSDV_TYPE_PADDING,	"padding"},
+};
+#define NUM_TYPES (sizeof(types)/sizeof(types[0]))
+
+static uint8_t packets[MAX_PACKETS][SSDV_PKT_SIZE];
+static uint8_t jpeg[MAX_JPEG];
+
+static int failed;
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void fail(const char *file, int quality, const char *type, const char *what)
+{
+	printf("FAIL %s q%d %s: %s\n", file, quality, type, what);
+	failed++;
+}
+
+/* Encodes the image, returns the number of packets or -1 on an encoder error */
+static int encode(const uint8_t *img, size_t len, uint8_t type, int quality)
+{
+	ssdv_t s;
+	size_t pos = 0;
+	int n = 0;
+	char c;
+
+	ssdv_enc_init(&s, type, "N0CALL", 0, quality);
+	ssdv_enc_set_buffer(&s, packets[0]);
+
+	while(true) {
+		while((c = ssdv_enc_get_packet(&s)) == SSDV_FEED_ME) {
+			size_t r = len - pos > FEED_SIZE ? FEED_SIZE : len - pos;
+			if(r == 0)
+				return -1; /* Premature end of the image */
+			ssdv_enc_feed(&s, img + pos, r);
+			pos += r;
+		}
+		if(c == SSDV_EOI)
+			return n;
+		if(c != SSDV_OK || ++n >= MAX_PACKETS)
+			return -1;
+		ssdv_enc_set_buffer(&s, packets[n]);
+	}
+}
+
+/*
+ * Decodes the packets (lost packets are skipped), returns the JPEG length or
+ * 0 if nothing could be decoded. Packets with errors are corrected first.
+ */
+static size_t decode(int n, const uint8_t *lost)
+{
+	ssdv_t s;
+	uint8_t pkt[SSDV_PKT_SIZE];
+	uint8_t *out;
+	size_t out_len = 0;
+	int errors, fed = 0;
+
+	ssdv_dec_init(&s);
+	ssdv_dec_set_buffer(&s, jpeg, MAX_JPEG);
+	for(int i = 0; i < n; i++) {
+		if(lost != NULL && lost[i])
+			continue;
+		memcpy(pkt, packets[i], SSDV_PKT_SIZE);
+		if(ssdv_dec_is_packet(pkt, &errors) != 0)
+			continue;
+		ssdv_dec_feed(&s, pkt);
+		fed++;
+	}
+	if(fed == 0)
+		return 0;
+	ssdv_dec_get_jpeg(&s, &out, &out_len);
+	return out_len;
+}
+
+/* Compares with or writes the golden file, returns false on a mismatch */
+static bool golden(const char *dir, bool write, const char *file, int quality, size_t len)
+{
+	char name[1024];
+	const char *base = strrchr(file, '/') ? strrchr(file, '/') + 1 : file;
+	snprintf(name, sizeof(name), "%s/%s-q%d.jpg", dir, base, quality);
+
+	FILE *f = fopen(name, write ? "wb" : "rb");
+	if(f == NULL)
+		return false; /* A missing golden file fails as well, run with -w to add an image */
+
+	bool ok = true;
+	if(write) {
+		ok = fwrite(jpeg, 1, len, f) == len;
+	} else {
+		static uint8_t ref[MAX_JPEG];
+		size_t ref_len = fread(ref, 1, MAX_JPEG, f);
+		ok = ref_len == len && !memcmp(ref, jpeg, len);
+	}
+	fclose(f);
+	return ok;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "Usage: %s [-g dir [-w]] [-l loss] [-r runs] [-s seed] file.jpg...\n"
+		"  -g dir   compare the decoded images with the golden files in dir\n"
+		"  -w       write the golden files instead of comparing\n"
+		"  -l loss  packet loss in percent for the loss test (default 10)\n"
+		"  -r runs  encoder/decoder runs per image for the timing (default 3)\n"
+		"  -s seed  seed of the random loss and errors\n", name);
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	const char *dir = NULL;
+	bool write = false;
+	int loss = 10;
+	int runs = 3;
+	unsigned int seed = 1;
+	int opt;
+
+	while((opt = getopt(argc, argv, "g:wl:r:s:")) != -1) {
+		switch(opt) {
+			case 'g': dir = optarg; break;
+			case 'w': write = true; break;
+			case 'l': loss = atoi(optarg); break;
+			case 'r': runs = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+			case 's': seed = strtoul(optarg, NULL, 0); break;
+			default: usage(argv[0]);
+		}
+	}
+	if(optind >= argc || (write && dir == NULL))
+		usage(argv[0]);
+	srand(seed);
+
+	static uint8_t img[MAX_JPEG];
+	static uint8_t ref[MAX_JPEG];
+	static uint8_t lost[MAX_PACKETS];
+	double enc_bytes = 0, enc_time = 0, dec_packets = 0, dec_time = 0;
+
+	printf("%-24s %1s %-7s %7s %8s %8s %9s\n", "image", "q", "type", "packets", "jpeg", "loss", "enc/dec");
+	for(int a = optind; a < argc; a++) {
+		FILE *f = fopen(argv[a], "rb");
+		if(f == NULL) {
+			perror(argv[a]);
+			failed++;
+			continue;
+		}
+		size_t len = fread(img, 1, MAX_JPEG, f);
+		fclose(f);
+
+		for(int q = 0; q <= 7; q++) {
+			size_t ref_len = 0;
+
+			for(uint8_t t = 0; t < NUM_TYPES; t++) {
+				const char *type = types[t].name;
+
+				/* Timing (the packets of the last run are kept) */
+				int n = 0;
+				double t0 = now();
+				for(int r = 0; r < runs; r++)
+					n = encode(img, len, types[t].type, q);
+				double t1 = now();
+				if(n <= 0) {
+					fail(argv[a], q, type, "encoder error");
+					continue;
+				}
+				size_t out_len = 0;
+				for(int r = 0; r < runs; r++)
+					out_len = decode(n, NULL);
+				double t2 = now();
+				enc_bytes += (double)len * runs;
+				enc_time += t1 - t0;
+				dec_packets += (double)n * runs;
+				dec_time += t2 - t1;
+
+				/* Conformance */
+				if(out_len == 0) {
+					fail(argv[a], q, type, "decoder error");
+					continue;
+				}
+				if(ref_len == 0) {
+					ref_len = out_len;
+					memcpy(ref, jpeg, out_len);
+				} else if(out_len != ref_len || memcmp(ref, jpeg, out_len)) {
+					fail(argv[a], q, type, "differs from the first packet type");
+				}
+				if(dir != NULL && t == 0 && !golden(dir, write, argv[a], q, out_len))
+					fail(argv[a], q, type, write ? "golden file not written" : "differs from the golden file");
+
+				if(types[t].type == SSDV_TYPE_NORMAL) {
+					for(int i = 0; i < n; i++) {
+						for(int e = 0; e < FEC_ERRORS; e++)
+							packets[i][1 + rand() % (SSDV_PKT_SIZE-1)] ^= 1 + rand() % 255;
+					}
+					if(decode(n, NULL) != ref_len || memcmp(ref, jpeg, ref_len))
+						fail(argv[a], q, type, "FEC did not correct the byte errors");
+				}
+
+				/* Random packet loss, the first packet always arrives (it carries the image header) */
+				int n_lost = 0;
+				for(int i = 0; i < n; i++) {
+					lost[i] = i > 0 && rand() % 100 < loss;
+					n_lost += lost[i];
+				}
+				size_t lost_len = decode(n, lost);
+				if(lost_len == 0)
+					fail(argv[a], q, type, "nothing decoded with packet loss");
+
+				printf("%-24.24s %d %-7s %7d %8zu %3d%% %4zu %4.0f/%-4.0f\n",
+					strrchr(argv[a], '/') ? strrchr(argv[a], '/') + 1 : argv[a], q, type, n, out_len,
+					n_lost * 100 / n, lost_len * 100 / out_len,
+					(double)len * runs / (t1 - t0) / 1e3, (double)n * runs / (t2 - t1) / 1e3);
+			}
+		}
+	}
+
+	printf("\nColumns: loss = packets lost and JPEG size decoded in percent, enc/dec = kB/s JPEG input and kpackets/s\n");
+	if(enc_time > 0 && dec_time > 0)
+		printf("Total: encoder %.0f kB/s, decoder %.0f packets/s\n", enc_bytes / enc_time / 1e3, dec_packets / dec_time);
+	printf("%s (%d failed)\n", failed ? "FAILED" : "OK", failed);
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,83 @@
+/*
+ * Incremental SSDV decoder for the ground station.
+ * Wraps the SSDV decoder of the tracker firmware. One decoder is kept per
+ * image, packets are fed as they are received and a JPEG can be taken at
+ * any time without ending the decoding.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "ssdv.h"
+
+typedef struct {
+	ssdv_t ssdv;
+	uint8_t *buffer;
+	size_t length;
+} ssdvdec_t;
+
+/* Moves a pointer into the decoder state over to a copy of the state */
+#define REBASE(copy, orig, ptr) \
+	((ptr) = (void*)((uint8_t*)(ptr) - (uint8_t*)(orig) + (uint8_t*)(copy)))
+
+ssdvdec_t* ssdvdec_new(size_t length)
+{
+	ssdvdec_t *d = malloc(sizeof(ssdvdec_t));
+	if(d == NULL)
+		return NULL;
+	d->buffer = malloc(length);
+	if(d->buffer == NULL) {
+		free(d);
+		return NULL;
+	}
+	d->length = length;
+	ssdv_dec_init(&d->ssdv);
+	ssdv_dec_set_buffer(&d->ssdv, d->buffer, length);
+	return d;
+}
+
+void ssdvdec_free(ssdvdec_t *d)
+{
+	free(d->buffer);
+	free(d);
+}
+
+/* Feeds the next packet (SSDV_PKT_SIZE bytes), packets must be in order */
+int ssdvdec_feed(ssdvdec_t *d, uint8_t *packet)
+{
+	return ssdv_dec_feed(&d->ssdv, packet);
+}
+
+/*
+ * Writes the JPEG of the packets fed so far into jpeg. Missing parts of the
+ * image are filled. The decoder itself is not changed, so feeding can be
+ * continued. Returns the JPEG length or 0 if jpeg is too small.
+ */
+size_t ssdvdec_get_jpeg(ssdvdec_t *d, uint8_t *jpeg, size_t length)
+{
+	size_t used = d->ssdv.outp - d->ssdv.out;
+	if(used >= length)
+		return 0;
+
+	ssdv_t *s = malloc(sizeof(ssdv_t));
+	if(s == NULL)
+		return 0;
+	memcpy(s, &d->ssdv, sizeof(ssdv_t));
+	for(int i = 0; i < 2; i++) {
+		REBASE(s, &d->ssdv, s->sdht[i][0]);
+		REBASE(s, &d->ssdv, s->sdht[i][1]);
+		REBASE(s, &d->ssdv, s->ddht[i][0]);
+		REBASE(s, &d->ssdv, s->ddht[i][1]);
+		if(s->sdqt[i] != NULL) REBASE(s, &d->ssdv, s->sdqt[i]);
+		if(s->ddqt[i] != NULL) REBASE(s, &d->ssdv, s->ddqt[i]);
+	}
+
+	memcpy(jpeg, d->buffer, used);
+	ssdv_dec_set_buffer(s, jpeg, length);
+
+	uint8_t *out;
+	size_t out_len = 0;
+	if(s->packet_id > 0)
+		ssdv_dec_get_jpeg(s, &out, &out_len);
+	free(s);
+	return out_len;
+}
@@ -0,0 +1,21 @@
+#ifndef __TYPES_H__
+#define __TYPES_H__
+
+/* Host build of the tracker tools, the power budget configuration only */
+#include "ch.h"
+
+typedef int8_t  radio_pwr_t;
+typedef uint16_t volt_level_t;
+
+typedef struct {
+  bool              enabled;
+  uint16_t          capacity;
+  volt_level_t      vbat_empty;
+  volt_level_t      vbat_full;
+  uint8_t           soc_min;
+  uint8_t           soc_nominal;
+  uint16_t          scale_min;
+  uint16_t          scale_max;
+} power_conf_t;
+
+#endif
@@ -0,0 +1,146 @@
+#!/usr/bin/python3
+
+import sys,re,struct
+import argparse
+import serial
+
+# Parse arguments from terminal
+parser = argparse.ArgumentParser(description='Decoder for binary trace records of the tracker debug port (TRACE_BINARY)')
+parser.add_argument('elf', help='Firmware ELF file the tracker is running (e.g. build/pp10a/pp10a.elf)')
+parser.add_argument('-d', '--device', help='Serial device or file (\'-\' for stdin)', default='-')
+parser.add_argument('-b', '--baudrate', help='Baudrate for serial device', default=115200, type=int)
+parser.add_argument('-f', '--frequency', help='System tick frequency (CH_CFG_ST_FREQUENCY)', default=5000, type=int)
+args = parser.parse_args()
+
+SYNC = b'\xA5\x5A'
+TEXT = 0xFF
+MAX_ARGS = 4
+
+""" Loads the allocated sections of the ELF file, format strings and file names are looked up by address """
+class Elf:
+	def __init__(self, filename):
+		with open(filename, 'rb') as f:
+			data = f.read()
+		if data[0:4] != b'\x7fELF' or data[4] != 1:
+			raise ValueError('%s is no ELF32 file' % filename)
+
+		shoff, = struct.unpack_from('<I', data, 0x20)
+		shentsize,shnum = struct.unpack_from('<HH', data, 0x2E)
+
+		self.sections = []
+		for i in range(shnum):
+			(name,typ,flags,addr,offset,size) = struct.unpack_from('<IIIIII', data, shoff + i*shentsize)
+			if flags & 0x2 and typ != 8: # SHF_ALLOC and not SHT_NOBITS
+				self.sections.append((addr, size, data[offset:offset+size]))
+
+	def string(self, addr):
+		for (base, size, content) in self.sections:
+			if base <= addr < base+size:
+				end = content.find(b'\x00', addr-base)
+				return content[addr-base:end].decode('ascii', 'replace')
+		return None
+
+""" Converts a chprintf format string into text using the recorded arguments """
+spec = re.compile('%([-+ 0#]*)(\d*)(?:\.(\d+))?([lL]?)([a-zA-Z%])')
+def format_event(elf, fmt, values):
+	values = list(values)
+
+	def conv(m):
+		(flags,width,prec,size,typ) = m.groups()
+		if typ == '%':
+			return '%'
+		val = values.pop(0) if len(values) else 0
+		pyfmt = '%' + flags + width + ('.' + prec if prec else '')
+		if typ in 'dDi':
+			return (pyfmt + 'd') % struct.unpack('<i', struct.pack('<I', val))[0]
+		if typ in 'uU':
+			return (pyfmt + 'd') % val
+		if typ in 'xX':
+			return (pyfmt + typ) % val
+		if typ in 'oO':
+			return (pyfmt + 'o') % val
+		if typ == 'c':
+			return (pyfmt + 'c') % chr(val & 0xFF)
+		if typ == 's':
+			s = elf.string(val)
+			return (pyfmt + 's') % (s if s is not None else '<0x%08x>' % val)
+		if typ == 'p':
+			return '0x%08x' % val
+		return '?'
+
+	return spec.sub(conv, fmt)
+
+def timestamp(ticks):
+	return '[%8d.%03d]' % (ticks // args.frequency, (ticks*1000 // args.frequency) % 1000)
+
+""" Reads records from the stream and prints them as text lines """
+def decode(elf, read):
+	buf = b''
+	while True:
+		data = read()
+		if not len(data):
+			return
+		buf += data
+
+		while True:
+			start = buf.find(SYNC)
+			if start < 0:
+				buf = buf[-1:]
+				break
+			buf = buf[start:]
+			if len(buf) < 3:
+				break
+
+			kind = buf[2]
+			if kind == TEXT:
+				if len(buf) < 8:
+					break
+				length = 8 + buf[7] + 1
+			elif kind <= MAX_ARGS:
+				length = 3 + 14 + kind*4 + 1
+			else: # Invalid record kind
+				buf = buf[2:]
+				continue
+			if len(buf) < length:
+				break
+
+			rec = buf[:length]
+			chk = 0
+			for b in rec[2:-1]:
+				chk ^= b
+			if chk != rec[-1]: # Checksum error, resynchronize
+				buf = buf[2:]
+				continue
+			buf = buf[length:]
+
+			if kind == TEXT:
+				print(rec[8:-1].decode('ascii', 'replace'))
+			else:
+				(ticks,file,line,fmt) = struct.unpack_from('<IIHI', rec, 3)
+				values = struct.unpack_from('<%dI' % kind, rec, 17)
+				file = elf.string(file) or '?'
+				fmt = elf.string(fmt)
+				text = format_event(elf, fmt, values) if fmt is not None else '<unknown format>'
+				print('%s[EVENT][%12s %04d] %s' % (timestamp(ticks), file.split('/')[-1], line, text))
+			sys.stdout.flush()
+
+elf = Elf(args.elf)
+
+if args.device == '-': # Source stdin
+	decode(elf, lambda: sys.stdin.buffer.read1(256))
+
+elif not args.device.startswith('/dev/'): # Source file
+	with open(args.device, 'rb') as f:
+		decode(elf, lambda: f.read(256))
+
+else: # Source Serial connection
+	try:
+		serr = serial.Serial(
+			port=args.device,
+			baudrate=args.baudrate,
+		)
+	except:
+		sys.stderr.write('Error: Could not open serial port\n')
+		sys.exit(1)
+
+	decode(elf, lambda: serr.read(1))
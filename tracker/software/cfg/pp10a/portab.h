@@ -180,6 +180,14 @@
 
 #define USE_12_BIT_PWM              FALSE
 
+/*
+ * Run length code PWM entries which repeat the prior entry.
+ * Entries within tolerance (ICU counts) of the prior entry are counted.
+ * The accumulated timing error of a run stays within the tolerance.
+ */
+#define USE_RLE_PWM                 TRUE
+#define PWM_RLE_TOLERANCE           32
+
 /*
  * Allocate PWM buffers from a CCM heap/pool.
  * Implements fragmented queue/buffer objects.
@@ -197,8 +205,16 @@
 #define NUMBER_PWM_FIFOS            5U
 /* Number of PWM data entries per queue object. */
 #define PWM_DATA_SLOTS              200
-/* Number of PWM queue objects in total. */
+/* Number of PWM queue objects allocated when the decoder is opened. */
 #define PWM_DATA_BUFFERS            30
+/* Maximum number of PWM queue objects when the pool grows under load. */
+#define PWM_DATA_BUFFERS_MAX        60
+/* Number of PWM queue objects added each time the pool grows. */
+#define PWM_DATA_BUFFERS_GROW       10
+/* Free objects at or below which the decoder grows the pool. */
+#define PWM_DATA_BUFFERS_LOW        8
+/* Free objects at or below which the oldest in-flight stream is shed. */
+#define PWM_DATA_BUFFERS_RESERVE    4
 #else /* USE_HEAP_PWM_BUFFER != TRUE */
 /* Use factory FIFO as stream control with integrated PWM buffer. */
 #define NUMBER_PWM_FIFOS            3U
@@ -15,7 +15,7 @@ int main(void) {
     /* Setup core IO peripherals. */
     pktConfigureCoreIO();
 
-    /* Setup the mutex for trace output. */
+    /* Setup trace output and start the trace writer thread. */
     debug_init();
 
 #if ACTIVATE_CONSOLE
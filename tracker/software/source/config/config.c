@@ -77,6 +77,9 @@ const conf_t conf_flash_default = {
         // Image settings
         .res = RES_VGA,
         .quality = 4,
+        .packets = 0,
+        .preview = PREVIEW_NONE,
+        .preview_wait = TIME_S2I(30),
         .buf_size = 50 * 1024,
         .redundantTx = false
     },
@@ -102,6 +105,9 @@ const conf_t conf_flash_default = {
         // Image settings
         .res = RES_QVGA,
         .quality = 4,
+        .packets = 0,
+        .preview = PREVIEW_NONE,
+        .preview_wait = TIME_S2I(30),
         .buf_size = 15 * 1024,
         .redundantTx = false
     },
@@ -193,5 +199,34 @@ const conf_t conf_flash_default = {
        .path = "WIDE2-1",
     },
 
+    // Transmit airtime budget (duty cycle in 1/1000, 0 disables the limit)
+    .airtime = {
+       .total = 0,
+       .image = 0,
+       .telemetry = 0,
+       .digipeat = 0,
+       .beacon = 0,
+       .window = TIME_S2I(600),
+       .max_defer = TIME_S2I(60),
+       // Receive resumes after every burst. Listening within a burst costs
+       // the window plus a transmit set up per window (a 2FSK image packet
+       // takes about 250ms), so it is off unless the digipeater needs it.
+       .listen = 0,
+       .listen_max = TIME_MS2I(1500),
+       .listen_every = 8
+    },
+
+    // Power budget (image cycle, burst and power follow battery state of charge)
+    .power = {
+       .enabled = false,
+       .capacity = 7400, // mWh
+       .vbat_empty = 3000, // mV
+       .vbat_full = 4150, // mV
+       .soc_min = 20, // %
+       .soc_nominal = 60, // %
+       .scale_min = 250, // 1/1000
+       .scale_max = 2000 // 1/1000
+    },
+
     .magic = CONFIG_MAGIC_DEFAULT // Do not remove. This is the activation bit.
 };
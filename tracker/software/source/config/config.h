@@ -3,6 +3,7 @@
 
 #define TRACE_TIME					TRUE		/* Enables time tracing on debugging port */
 #define TRACE_FILE					TRUE		/* Enables file and line tracing on debugging port */
+#define TRACE_BINARY				FALSE		/* Sends trace as binary records on debugging port (decode with tracedec.py) */
 
 #include "types.h"
 
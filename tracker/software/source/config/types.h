@@ -63,6 +63,12 @@ typedef enum {
 	RES_MAX
 } resolution_t;
 
+typedef enum {
+	PREVIEW_NONE = 0,							// Image only
+	PREVIEW_FIRST,								// Preview, then the image unless rejected
+	PREVIEW_ONLY								// Preview, the first and last image packet, others on repeat request only
+} preview_t;
+
 typedef struct {
   radio_pwr_t       pwr;
   radio_freq_t      freq;
@@ -132,7 +138,10 @@ typedef struct {
   char              call[AX25_MAX_ADDR_LEN];
   char              path[16];
   resolution_t      res;					// Picture resolution
-  uint8_t           quality;				// SSDV Quality ranging from 0-7
+  uint8_t           quality;				// SSDV Quality ranging from 0-7 (maximum if packets is set)
+  uint16_t          packets;				// Packet budget per image, quality and resolution are reduced to fit (0: no budget)
+  preview_t         preview;				// Quality 0 preview sent first, the image follows with the next image ID
+  sysinterval_t     preview_wait;			// Time to wait for a reject after the preview
   bool              flip;                   // 180 image rotation
   uint32_t          buf_size;		    	// SRAM buffer size for the picture
 } img_app_conf_t;
@@ -171,6 +180,32 @@ typedef struct {
   bool              enabled;
 } thd_base_conf_t;
 
+/* Transmit airtime budget. Duty cycles are in 1/1000 (0: no limit). */
+typedef struct {
+  uint16_t          total;                  // Duty cycle of all transmissions
+  uint16_t          image;                  // Duty cycle of image packets
+  uint16_t          telemetry;              // Duty cycle of log, telemetry config and message packets
+  uint16_t          digipeat;               // Duty cycle of digipeated packets
+  uint16_t          beacon;                 // Duty cycle of position beacons
+  sysinterval_t     window;                 // Averaging window. Unused airtime accumulates up to duty * window
+  sysinterval_t     max_defer;              // Image and telemetry packets waiting longer for airtime are dropped
+  sysinterval_t     listen;                 // Receive window between the packets of a burst (0: no receive during bursts)
+  sysinterval_t     listen_max;             // Receive window is extended up to this time while a carrier is present
+  uint8_t           listen_every;           // Receive window after every this many packets of a burst (0, 1: every packet)
+} airtime_conf_t;
+
+/* Power budget. Image transmission is scaled by battery state of charge. */
+typedef struct {
+  bool              enabled;                // Scale image cycle, burst length and TX power
+  uint16_t          capacity;               // Battery capacity in mWh (0: no state of charge estimate)
+  volt_level_t      vbat_empty;             // Battery voltage at 0% state of charge
+  volt_level_t      vbat_full;              // Battery voltage at 100% state of charge
+  uint8_t           soc_min;                // State of charge (%) at and below which scale_min applies
+  uint8_t           soc_nominal;            // State of charge (%) at which the configured values apply
+  uint16_t          scale_min;              // Scale at soc_min in 1/1000
+  uint16_t          scale_max;              // Scale at 100% state of charge in 1/1000
+} power_conf_t;
+
 /* APRS configuration. */
 typedef struct {
   thd_rx_conf_t     rx;
@@ -206,6 +241,10 @@ typedef struct {
   // These are sends by the tracker which are not in response to a query.
   thd_base_conf_t   base;
 
+  airtime_conf_t    airtime;                // Transmit airtime budget
+
+  power_conf_t      power;                  // Power budget
+
   uint32_t          magic;                  // Key that indicates if the flash is loaded or has been updated
   uint16_t          crc;                    // CRC to verify content
 } conf_t;
@@ -39,11 +39,12 @@ bool BME280_isAvailable(uint8_t id)
 }
 
 /**
-  * Initializes BME280 and reads calibration data
+  * Sets up the handle and reads calibration data. The sensor is left in
+  * sleep mode, use BME280_Trigger to start a conversion.
   * @handle Handle for the BME280 of type bme280_t
   * @id ID of the BME280, 0: internal, 1 and 2: external
   */
-void BME280_Init(bme280_t *handle, uint8_t id)
+void BME280_Setup(bme280_t *handle, uint8_t id)
 {
 	uint8_t tmp1;
 	uint8_t tmp2;
@@ -56,6 +57,7 @@ void BME280_Init(bme280_t *handle, uint8_t id)
 			handle->i2c_read16 = &I2C_read16;
 			handle->i2c_read16_LE = &I2C_read16_LE;
 			handle->i2c_write8 = &I2C_write8;
+			handle->i2c_readN = &I2C_readN;
 			handle->i2c_address = 0x77;
 			break;
 
@@ -66,6 +68,7 @@ void BME280_Init(bme280_t *handle, uint8_t id)
 			handle->i2c_read16 = &eI2C_read16;
 			handle->i2c_read16_LE = &eI2C_read16_LE;
 			handle->i2c_write8 = &eI2C_write8;
+			handle->i2c_readN = &eI2C_readN;
 			handle->i2c_address = id==BME280_E1 ? 0x77 : 0x76;
 			break;
 	}
@@ -97,6 +100,16 @@ void BME280_Init(bme280_t *handle, uint8_t id)
 	handle->calib.dig_H5 = (((int8_t)tmp1) << 4) | (tmp2 >> 4 & 0x0F);
 
 	(*handle->i2c_read8)(handle->i2c_address, BME280_REGISTER_DIG_H6, (uint8_t*)&handle->calib.dig_H6);
+}
+
+/**
+  * Initializes BME280, reads calibration data and starts normal mode
+  * @handle Handle for the BME280 of type bme280_t
+  * @id ID of the BME280, 0: internal, 1 and 2: external
+  */
+void BME280_Init(bme280_t *handle, uint8_t id)
+{
+	BME280_Setup(handle, id);
 
 	(*handle->i2c_write8)(handle->i2c_address, BME280_REGISTER_CONTROLHUMID, 0x03); // Set before CONTROL (DS 5.4.3)
 	(*handle->i2c_write8)(handle->i2c_address, BME280_REGISTER_CONTROL, 0x3F);
@@ -105,13 +118,117 @@ void BME280_Init(bme280_t *handle, uint8_t id)
 	BME280_getTemperature(handle); // Set t_fine
 }
 
+/**
+  * Starts a single conversion in forced mode (same oversampling as normal
+  * mode). The sensor returns to sleep mode when done. The result is
+  * available after BME280_MEASURE_TIME.
+  */
+bool BME280_Trigger(bme280_t *handle)
+{
+	if(!(*handle->i2c_write8)(handle->i2c_address, BME280_REGISTER_CONTROLHUMID, 0x03)) // Set before CONTROL (DS 5.4.3)
+		return false;
+	return (*handle->i2c_write8)(handle->i2c_address, BME280_REGISTER_CONTROL, 0x3D);
+}
+
+/**
+  * Compensates raw temperature and sets t_fine
+  * @return Temperature in degC * 100
+  */
+static int16_t BME280_compensateTemperature(bme280_t *handle, int32_t adc_T)
+{
+	int32_t var1, var2;
+
+	var1 = ((((adc_T>>3) - ((int32_t)handle->calib.dig_T1 <<1))) * ((int32_t)handle->calib.dig_T2)) >> 11;
+	var2 = (((((adc_T>>4) - ((int32_t)handle->calib.dig_T1)) * ((adc_T>>4) - ((int32_t)handle->calib.dig_T1))) >> 12) * ((int32_t)handle->calib.dig_T3)) >> 14;
+
+	handle->t_fine = var1 + var2;
+
+	return (handle->t_fine * 5 + 128) >> 8;
+}
+
+/**
+  * Compensates raw pressure (t_fine must be set)
+  * @return Pressure in Pa * 256, 0 if calibration is invalid
+  */
+static uint32_t BME280_compensatePressure(bme280_t *handle, int32_t adc_P)
+{
+	int64_t var1, var2, p;
+
+	var1 = ((int64_t)handle->t_fine) - 128000;
+	var2 = var1 * var1 * (int64_t)handle->calib.dig_P6;
+	var2 = var2 + ((var1*(int64_t)handle->calib.dig_P5)<<17);
+	var2 = var2 + (((int64_t)handle->calib.dig_P4)<<35);
+	var1 = ((var1 * var1 * (int64_t)handle->calib.dig_P3)>>8) + ((var1 * (int64_t)handle->calib.dig_P2)<<12);
+	var1 = (((((int64_t)1)<<47)+var1))*((int64_t)handle->calib.dig_P1)>>33;
+
+	if (var1 == 0)
+		return 0;  // avoid exception caused by division by zero
+
+	p = 1048576 - adc_P;
+	p = (((p<<31) - var2)*3125) / var1;
+	var1 = (((int64_t)handle->calib.dig_P9) * (p>>13) * (p>>13)) >> 25;
+	var2 = (((int64_t)handle->calib.dig_P8) * p) >> 19;
+
+	return ((p + var1 + var2) >> 8) + (((int64_t)handle->calib.dig_P7)<<4);
+}
+
+/**
+  * Compensates raw humidity (t_fine must be set)
+  * @return rel. humidity in %
+  */
+static uint8_t BME280_compensateHumidity(bme280_t *handle, int32_t adc_H)
+{
+	int32_t v_x1_u32r;
+
+	v_x1_u32r = (handle->t_fine - ((int32_t)76800));
+
+	v_x1_u32r = (((((adc_H << 14) - (((int32_t)handle->calib.dig_H4) << 20) -
+		(((int32_t)handle->calib.dig_H5) * v_x1_u32r)) + ((int32_t)16384)) >> 15) *
+		(((((((v_x1_u32r * ((int32_t)handle->calib.dig_H6)) >> 10) *
+		(((v_x1_u32r * ((int32_t)handle->calib.dig_H3)) >> 11) + ((int32_t)32768))) >> 10) +
+		((int32_t)2097152)) * ((int32_t)handle->calib.dig_H2) + 8192) >> 14));
+
+	v_x1_u32r = (v_x1_u32r - (((((v_x1_u32r >> 15) * (v_x1_u32r >> 15)) >> 7) * ((int32_t)handle->calib.dig_H1)) >> 4));
+
+	v_x1_u32r = (v_x1_u32r < 0) ? 0 : v_x1_u32r;
+	v_x1_u32r = (v_x1_u32r > 419430400) ? 419430400 : v_x1_u32r;
+	float h = (v_x1_u32r>>12);
+	return h / 1020;
+}
+
+/**
+  * Reads pressure, temperature and humidity of the last conversion in one
+  * burst. The data registers are shadowed, so all values belong to the same
+  * conversion (DS 5.1).
+  * @param press Pressure in Pa * 10
+  * @param hum rel. humidity in %
+  * @param temp Temperature in degC * 100
+  * @return true if the read succeeded
+  */
+bool BME280_readData(bme280_t *handle, uint32_t *press, uint8_t *hum, int16_t *temp)
+{
+	uint8_t buf[8];
+
+	if(!(*handle->i2c_readN)(handle->i2c_address, BME280_REGISTER_PRESSUREDATA, buf, sizeof(buf)))
+		return false;
+
+	int32_t adc_P = (buf[0] << 12) | (buf[1] << 4) | (buf[2] >> 4);
+	int32_t adc_T = (buf[3] << 12) | (buf[4] << 4) | (buf[5] >> 4);
+	int32_t adc_H = (buf[6] << 8) | buf[7];
+
+	*temp = BME280_compensateTemperature(handle, adc_T);
+	*press = BME280_compensatePressure(handle, adc_P) / 26;
+	*hum = BME280_compensateHumidity(handle, adc_H);
+	return true;
+}
+
 /**
   * Reads the temperature
   * @return Temperature in degC * 100
   */
 int16_t BME280_getTemperature(bme280_t *handle)
 {
-	int32_t var1, var2, adc_T;
+	int32_t adc_T;
 	uint16_t tmp;
 
 	(*handle->i2c_read16)(handle->i2c_address, BME280_REGISTER_TEMPDATA, &tmp);
@@ -121,12 +238,7 @@ int16_t BME280_getTemperature(bme280_t *handle)
 	adc_T |= tmp & 0xFF;
 	adc_T >>= 4;
 
-	var1 = ((((adc_T>>3) - ((int32_t)handle->calib.dig_T1 <<1))) * ((int32_t)handle->calib.dig_T2)) >> 11;
-	var2 = (((((adc_T>>4) - ((int32_t)handle->calib.dig_T1)) * ((adc_T>>4) - ((int32_t)handle->calib.dig_T1))) >> 12) * ((int32_t)handle->calib.dig_T3)) >> 14;
-
-	handle->t_fine = var1 + var2;
-
-	return (handle->t_fine * 5 + 128) >> 8;
+	return BME280_compensateTemperature(handle, adc_T);
 }
 
 /**
@@ -135,7 +247,6 @@ int16_t BME280_getTemperature(bme280_t *handle)
   * @return Pressure in Pa * 10
   */
 uint32_t BME280_getPressure(bme280_t *handle, uint16_t means) {
-	int64_t var1, var2, p;
 	uint16_t tmp;
 
 	uint64_t sum = 0;
@@ -148,22 +259,10 @@ uint32_t BME280_getPressure(bme280_t *handle, uint16_t means) {
 		adc_P |= tmp & 0xFF;
 		adc_P >>= 4;
 
-		var1 = ((int64_t)handle->t_fine) - 128000;
-		var2 = var1 * var1 * (int64_t)handle->calib.dig_P6;
-		var2 = var2 + ((var1*(int64_t)handle->calib.dig_P5)<<17);
-		var2 = var2 + (((int64_t)handle->calib.dig_P4)<<35);
-		var1 = ((var1 * var1 * (int64_t)handle->calib.dig_P3)>>8) + ((var1 * (int64_t)handle->calib.dig_P2)<<12);
-		var1 = (((((int64_t)1)<<47)+var1))*((int64_t)handle->calib.dig_P1)>>33;
-
-		if (var1 == 0)
-			return 0;  // avoid exception caused by division by zero
-
-		p = 1048576 - adc_P;
-		p = (((p<<31) - var2)*3125) / var1;
-		var1 = (((int64_t)handle->calib.dig_P9) * (p>>13) * (p>>13)) >> 25;
-		var2 = (((int64_t)handle->calib.dig_P8) * p) >> 19;
-
-		sum += ((p + var1 + var2) >> 8) + (((int64_t)handle->calib.dig_P7)<<4);
+		uint32_t p = BME280_compensatePressure(handle, adc_P);
+		if(p == 0)
+			return 0;
+		sum += p;
 	}
 
 	return sum/(means*26);
@@ -174,27 +273,10 @@ uint32_t BME280_getPressure(bme280_t *handle, uint16_t means) {
   * @return rel. humidity in % * 10
   */
 uint8_t BME280_getHumidity(bme280_t *handle) {
-	int32_t adc_H;
 	uint16_t tmp;
 	(*handle->i2c_read16)(handle->i2c_address, BME280_REGISTER_HUMIDDATA, &tmp);
-	adc_H = tmp;
-
-	int32_t v_x1_u32r;
 
-	v_x1_u32r = (handle->t_fine - ((int32_t)76800));
-
-	v_x1_u32r = (((((adc_H << 14) - (((int32_t)handle->calib.dig_H4) << 20) -
-		(((int32_t)handle->calib.dig_H5) * v_x1_u32r)) + ((int32_t)16384)) >> 15) *
-		(((((((v_x1_u32r * ((int32_t)handle->calib.dig_H6)) >> 10) *
-		(((v_x1_u32r * ((int32_t)handle->calib.dig_H3)) >> 11) + ((int32_t)32768))) >> 10) +
-		((int32_t)2097152)) * ((int32_t)handle->calib.dig_H2) + 8192) >> 14));
-
-	v_x1_u32r = (v_x1_u32r - (((((v_x1_u32r >> 15) * (v_x1_u32r >> 15)) >> 7) * ((int32_t)handle->calib.dig_H1)) >> 4));
-
-	v_x1_u32r = (v_x1_u32r < 0) ? 0 : v_x1_u32r;
-	v_x1_u32r = (v_x1_u32r > 419430400) ? 419430400 : v_x1_u32r;
-	float h = (v_x1_u32r>>12);
-	return h / 1020;
+	return BME280_compensateHumidity(handle, tmp);
 }
 
 /**
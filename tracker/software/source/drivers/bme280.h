@@ -47,6 +47,7 @@
 #define BME280_REGISTER_CAL26			0xE1
 
 #define BME280_REGISTER_CONTROLHUMID	0xF2
+#define BME280_REGISTER_STATUS			0xF3
 #define BME280_REGISTER_CONTROL			0xF4
 #define BME280_REGISTER_CONFIG			0xF5
 #define BME280_REGISTER_PRESSUREDATA	0xF7
@@ -54,6 +55,9 @@
 #define BME280_REGISTER_HUMIDDATA		0xFD
 
 
+// Max. measurement time for T x1, P x16, H x4 oversampling (DS 9.1)
+#define BME280_MEASURE_TIME				TIME_US2I(50750)
+
 #define BME280_I1	0x0
 #define BME280_E1	0x1
 #define BME280_E2	0x2
@@ -88,6 +92,7 @@ typedef struct {
 	bool (*i2c_read16)(uint8_t,uint8_t,uint16_t*);
 	bool (*i2c_read16_LE)(uint8_t,uint8_t,uint16_t*);
 	bool (*i2c_write8)(uint8_t,uint8_t,uint8_t);
+	bool (*i2c_readN)(uint8_t,uint8_t,uint8_t*,uint8_t);
 
 	// I2C Address
 	uint8_t i2c_address;
@@ -98,7 +103,10 @@ typedef struct {
 } bme280_t;
 
 bool BME280_isAvailable(uint8_t id);
+void BME280_Setup(bme280_t *handle, uint8_t id);
 void BME280_Init(bme280_t *handle, uint8_t id);
+bool BME280_Trigger(bme280_t *handle);
+bool BME280_readData(bme280_t *handle, uint32_t *press, uint8_t *hum, int16_t *temp);
 int16_t BME280_getTemperature(bme280_t *handle);
 uint32_t BME280_getPressure(bme280_t *handle, uint16_t means);
 uint8_t BME280_getHumidity(bme280_t *handle);
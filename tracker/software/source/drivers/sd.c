@@ -3,43 +3,185 @@
 #include "ff.h"
 #include "debug.h"
 #include "portab.h"
+#include "sd.h"
 //#include "config.h"
 
 MMCDriver MMCD1;
 bool sdInitialized = false;
 
-bool initSD(void)
+// Maximum speed SPI configuration
+static SPIConfig hs_spicfg = {
+	.ssport	= PAL_PORT(LINE_SD_CS),
+	.sspad	= PAL_PAD(LINE_SD_CS),
+	.cr1	= SPI_CR1_MSTR
+};
+
+// Low speed SPI configuration
+static SPIConfig ls_spicfg = {
+	.ssport	= PAL_PORT(LINE_SD_CS),
+	.sspad	= PAL_PAD(LINE_SD_CS),
+	.cr1	= SPI_CR1_BR_2 | SPI_CR1_BR_1 | SPI_CR1_MSTR
+};
+
+// MMC/SD over SPI driver configuration
+static MMCConfig mmccfg = {SPI_BUS1_DRIVER, &ls_spicfg, &hs_spicfg};
+
+/*
+ * The volume stays mounted while the card is present. All file operations
+ * are made from the SD service thread only. The SPI bus (shared with the radio)
+ * is acquired for each FatFs operation or write chunk and released between
+ * them. Mount, unmount and the jobs of the service thread are serialized by
+ * sd_mtx, so a caller of initSD() never mounts the card during a write.
+ */
+static FATFS fs;
+static FIL fdst;
+static MUTEX_DECL(sd_mtx);
+static thread_t *sd_thd;
+static bool sdMissingReported;
+static uint32_t sd_chunk;		// Write chunk size (cluster size, limited by SD_WRITE_CHUNK_MAX)
+
+static sd_job_t sd_job_objects[SD_JOB_SLOTS];
+static msg_t sd_job_msgs[SD_JOB_SLOTS];
+static objects_fifo_t sd_jobs;
+
+/**
+ * Acquires the SPI bus and configures it for the SD card. The radio driver
+ * stops SPI after each transaction, so SPI has to be started every time.
+ */
+static void sd_acquire(void)
 {
+	spiAcquireBus(SPI_BUS1_DRIVER);
+	spiStart(SPI_BUS1_DRIVER, &hs_spicfg);
+}
 
-  /*
-   * Quick check of card inserted.
-   * This is OK for in flight.
-   */
-  if(palReadLine(LINE_SD_DET)) {
-      TRACE_INFO("SD   > No SD card inserted");
-      sdInitialized = false;
-      return false;
-  }
-  TRACE_INFO("SD   > Access SD card");
+static void sd_release(void)
+{
+	spiReleaseBus(SPI_BUS1_DRIVER);
+}
 
-    /* NOTE: SD_CS line is set in board.h and initialized to HIGH. */
+/**
+ * Unmounts the volume after an error, initSD() will reconnect the card.
+ * Called with sd_mtx locked.
+ */
+static void sd_unmount(void)
+{
+	TRACE_INFO("SD   > Unmount");
+	sd_acquire();
+	f_mount(0, "", 0);
+	mmcDisconnect(&MMCD1);
+	sd_release();
+	sdInitialized = false;
+}
 
-	// Maximum speed SPI configuration
-	static SPIConfig hs_spicfg = {
-		.ssport	= PAL_PORT(LINE_SD_CS),
-		.sspad	= PAL_PAD(LINE_SD_CS),
-		.cr1	= SPI_CR1_MSTR
-	};
+/**
+ * Writes a job into a file. Data is written in chunks aligned to the cluster
+ * size and the SPI bus is released after each chunk, so the radio is not
+ * locked out during long writes.
+ */
+static bool sd_process_job(sd_job_t *job)
+{
+	FRESULT res, wres = FR_OK;
+	bool gres = true; // Optimist
 
-	// Low speed SPI configuration
-	static SPIConfig ls_spicfg = {
-		.ssport	= PAL_PORT(LINE_SD_CS),
-		.sspad	= PAL_PAD(LINE_SD_CS),
-		.cr1	= SPI_CR1_BR_2 | SPI_CR1_BR_1 | SPI_CR1_MSTR
-	};
+	const uint8_t *buffer = job->buffer != NULL ? job->buffer : job->data;
 
-	// MMC/SD over SPI driver configuration
-	static MMCConfig mmccfg = {SPI_BUS1_DRIVER, &ls_spicfg, &hs_spicfg};
+	// Open file
+	TRACE_INFO("SD   > Open file %s", job->filename);
+	sd_acquire();
+	if(job->append)
+		res = f_open(&fdst, (TCHAR*)job->filename, FA_OPEN_APPEND | FA_WRITE);
+	else
+		res = f_open(&fdst, (TCHAR*)job->filename, FA_CREATE_ALWAYS | FA_WRITE);
+	sd_release();
+	if(res != FR_OK)
+	{
+		TRACE_ERROR("SD   > Opening file failed (err=%d)", res);
+		if(res == FR_DISK_ERR || res == FR_NOT_READY)
+			sd_unmount();
+		return false;
+	}
+
+	// Write buffer into file
+	TRACE_INFO("SD   > Write buffer to file (len=%d)", job->len);
+	uint32_t written = 0;
+	while(written < job->len)
+	{
+		// First chunk fills up to the next cluster boundary
+		uint32_t n = sd_chunk - (f_tell(&fdst) % sd_chunk);
+		if(n > job->len - written)
+			n = job->len - written;
+
+		UINT len_written;
+		sd_acquire();
+		wres = f_write(&fdst, &buffer[written], n, &len_written);
+		sd_release();
+		written += len_written;
+
+		if(wres != FR_OK || len_written != n)
+		{
+			TRACE_ERROR("SD   > Writing failed (err=%d)", wres);
+			gres = false;
+			break;
+		}
+	}
+
+	// Close file
+	TRACE_INFO("SD   > Close file");
+	sd_acquire();
+	res = f_close(&fdst);
+	sd_release();
+	if(res != FR_OK)
+	{
+		TRACE_ERROR("SD   > Closing file failed (err=%d)", res);
+		gres = false;
+	}
+
+	// Unmount on a card error of the write or the close
+	if(!gres && (wres == FR_DISK_ERR || wres == FR_NOT_READY
+	             || res == FR_DISK_ERR || res == FR_NOT_READY))
+		sd_unmount();
+
+	return gres;
+}
+
+THD_FUNCTION(sdThread, arg)
+{
+	(void)arg;
+
+	while(true)
+	{
+		sd_job_t *job;
+		chFifoReceiveObjectTimeout(&sd_jobs, (void**)&job, TIME_INFINITE);
+
+		chMtxLock(&sd_mtx);
+		if(sdInitialized) {
+			job->result = sd_process_job(job);
+		} else {
+			TRACE_WARN("SD   > Card not available, write of %s discarded", job->filename);
+			job->result = false;
+		}
+		chMtxUnlock(&sd_mtx);
+
+		if(job->wait)
+			chBSemSignal(&job->done);	// Owner returns the job object
+		else
+			chFifoReturnObject(&sd_jobs, job);
+	}
+}
+
+/**
+ * Connects and mounts the SD card and starts the SD service thread on the
+ * first mount. Called with sd_mtx locked.
+ */
+static bool mountSD(void)
+{
+  sdMissingReported = false;
+  if(sdInitialized)
+    return true;
+
+  TRACE_INFO("SD   > Access SD card");
+
+    /* NOTE: SD_CS line is set in board.h and initialized to HIGH. */
 
 	// Check SD card presence
 	spiAcquireBus(SPI_BUS1_DRIVER);
@@ -51,83 +193,143 @@ bool initSD(void)
 	TRACE_DEBUG("SD   > Connect");
 	if(mmcConnect(&MMCD1)) {
 		TRACE_ERROR("SD   > SD card connection error");
-	} else {
-		TRACE_INFO("SD   > SD card connection OK");
-		sdInitialized = true;
-	}
-	spiReleaseBus(SPI_BUS1_DRIVER);
-
-	return sdInitialized;
-}
-
-bool writeBufferToFile(const char *filename, const uint8_t *buffer, uint32_t len)
-{
-	if(!sdInitialized)
+		spiReleaseBus(SPI_BUS1_DRIVER);
 		return false;
-
-	spiAcquireBus(SPI_BUS1_DRIVER);
-
-	static FATFS fs;
-	static FIL fdst;
-	FRESULT res;
-	bool gres = true; // Optimist
+	}
+	TRACE_INFO("SD   > SD card connection OK");
 
 	// Mount SD card
 	TRACE_INFO("SD   > Mount");
-	res = f_mount(&fs, "/", 0);
+	FRESULT res = f_mount(&fs, "/", 1);
+	spiReleaseBus(SPI_BUS1_DRIVER);
 	if(res != FR_OK)
 	{
-
 		TRACE_ERROR("SD   > Mounting failed (err=%d)", res);
-		gres = false;
+		return false;
+	}
 
-	} else {
+	sd_chunk = fs.csize * FF_MAX_SS;
+	if(sd_chunk > SD_WRITE_CHUNK_MAX)
+		sd_chunk = SD_WRITE_CHUNK_MAX;
+
+	// Start service thread on first mount
+	if(sd_thd == NULL) {
+		chFifoObjectInit(&sd_jobs, sizeof(sd_job_t), SD_JOB_SLOTS, sizeof(msg_t),
+		                 sd_job_objects, sd_job_msgs);
+		sd_thd = chThdCreateFromHeap(NULL, THD_WORKING_AREA_SIZE(2*1024), "SD", LOWPRIO + 5, sdThread, NULL);
+		if(sd_thd == NULL) {
+			TRACE_ERROR("SD   > Could not startup thread (not enough memory available)");
+			return false;
+		}
+	}
 
-		// Open file
-		TRACE_INFO("SD   > Open file %s", filename);
-		res = f_open(&fdst, (TCHAR*)filename, FA_CREATE_ALWAYS | FA_WRITE);
-		if(res != FR_OK)
-		{
+	sdInitialized = true;
+	return true;
+}
 
-			TRACE_ERROR("SD   > Opening file failed (err=%d)", res);
-			gres = false;
+/**
+ * Connects and mounts the SD card and starts the SD service thread.
+ * Returns immediately if the volume is already mounted.
+ */
+bool initSD(void)
+{
+  /*
+   * Quick check of card inserted.
+   * This is OK for in flight.
+   */
+  if(palReadLine(LINE_SD_DET)) {
+      /* Pending jobs are discarded by the service thread. */
+      chMtxLock(&sd_mtx);
+      if(sdInitialized || !sdMissingReported)
+        TRACE_INFO("SD   > No SD card inserted");
+      sdInitialized = false;
+      sdMissingReported = true;
+      chMtxUnlock(&sd_mtx);
+      return false;
+  }
+  if(sdInitialized)
+    return true;
 
-		} else {
+  chMtxLock(&sd_mtx);
+  bool ok = mountSD();
+  chMtxUnlock(&sd_mtx);
+  return ok;
+}
 
-			// Write buffer into file
-			TRACE_INFO("SD   > Write buffer to file (len=%d)", len);
-			uint32_t len_written;
-			f_write(&fdst, buffer, len, (UINT*)&len_written);
-			if(len_written != len)
-			{
-				TRACE_ERROR("SD   > Writing failed (err=%d)", res);
-				gres = false;
-			}
-
-			// Close file
-			TRACE_INFO("SD   > Close file");
-			res = f_close(&fdst);
-			if(res != FR_OK)
-			{
-				TRACE_ERROR("SD   > Closing file failed (err=%d)", res);
-				gres = false;
-			}
+/**
+ * Queues a write job. The buffer is referenced, not copied, unless copy is
+ * set (only for len <= SD_APPEND_MAX).
+ */
+static sd_job_t* sd_queue_job(const char *filename, const uint8_t *buffer, uint32_t len, bool append, bool wait, bool copy)
+{
+	if(!sdInitialized)
+		return NULL;
 
-		}
+	sd_job_t *job = chFifoTakeObjectTimeout(&sd_jobs, TIME_IMMEDIATE);
+	if(job == NULL) {
+		TRACE_WARN("SD   > Write queue full, %s discarded", filename);
+		return NULL;
+	}
 
-		// Unmount
-		TRACE_INFO("SD   > Unmount");
-		res = f_mount(0, "", 0);
-		if(res != FR_OK)
-		{
-			TRACE_ERROR("SD   > Unmounting failed (err=%d)", res);
-			gres = false;
-		}
+	strncpy(job->filename, filename, sizeof(job->filename)-1);
+	job->filename[sizeof(job->filename)-1] = 0;
+	if(copy) {
+		memcpy(job->data, buffer, len);
+		job->buffer = NULL;
+	} else {
+		job->buffer = buffer;
 	}
+	job->len = len;
+	job->append = append;
+	job->wait = wait;
+	job->result = false;
+	chBSemObjectInit(&job->done, true);
+
+	chFifoSendObject(&sd_jobs, job);
+	return job;
+}
 
-	spiReleaseBus(SPI_BUS1_DRIVER);
+/**
+ * Queues a buffer to be written into a new file (overwriting an existing file).
+ * The buffer must stay valid until waitWriteComplete() returned.
+ * Returns NULL if the card is not available or the queue is full.
+ */
+sd_job_t* writeBufferToFileAsync(const char *filename, const uint8_t *buffer, uint32_t len)
+{
+	return sd_queue_job(filename, buffer, len, false, true, false);
+}
 
-	return gres;
+/**
+ * Waits for a write job queued by writeBufferToFileAsync() and releases it
+ */
+bool waitWriteComplete(sd_job_t *job)
+{
+	chBSemWait(&job->done);
+	bool result = job->result;
+	chFifoReturnObject(&sd_jobs, job);
+	return result;
+}
+
+bool writeBufferToFile(const char *filename, const uint8_t *buffer, uint32_t len)
+{
+	sd_job_t *job = writeBufferToFileAsync(filename, buffer, len);
+	if(job == NULL)
+		return false;
+	return waitWriteComplete(job);
+}
+
+/**
+ * Appends data to a file without waiting for completion. The data is copied
+ * (len must not exceed SD_APPEND_MAX), so the caller may reuse its buffer.
+ * Returns true if the data has been queued.
+ */
+bool appendBufferToFile(const char *filename, const uint8_t *buffer, uint32_t len)
+{
+	if(len > SD_APPEND_MAX) {
+		TRACE_ERROR("SD   > Append of %d bytes exceeds limit", len);
+		return false;
+	}
+	return sd_queue_job(filename, buffer, len, true, false, true) != NULL;
 }
 
 #if HAL_USE_SDC || defined(__DOXYGEN__)
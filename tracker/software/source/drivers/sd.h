@@ -4,10 +4,29 @@
 #include "ch.h"
 #include "hal.h"
 
+#define SD_JOB_SLOTS			4		/* Number of queued write jobs */
+#define SD_WRITE_CHUNK_MAX		4096	/* Maximum bytes written per SPI bus acquisition */
+#define SD_APPEND_MAX			128		/* Maximum length of copied append data */
+#define SD_FILENAME_LENGTH		32
+
+typedef struct {
+	char				filename[SD_FILENAME_LENGTH];
+	const uint8_t		*buffer;	// Referenced data (NULL if data is copied)
+	uint8_t				data[SD_APPEND_MAX];
+	uint32_t			len;
+	bool				append;
+	bool				wait;		// Owner waits for completion and releases the job
+	bool				result;
+	binary_semaphore_t	done;
+} sd_job_t;
+
 extern MMCDriver MMCD1;
 
 bool initSD(void);
 bool writeBufferToFile(const char *filename, const uint8_t *buffer, uint32_t len);
+sd_job_t* writeBufferToFileAsync(const char *filename, const uint8_t *buffer, uint32_t len);
+bool waitWriteComplete(sd_job_t *job);
+bool appendBufferToFile(const char *filename, const uint8_t *buffer, uint32_t len);
 
 #endif
 
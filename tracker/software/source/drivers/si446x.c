@@ -1224,6 +1224,20 @@ static void Si446x_transmitTimeoutI(thread_t *tp) {
   chSysUnlockFromISR();
 }
 
+/*
+ * Set up the radio again for a send after it was released by the TX thread.
+ */
+static void Si446x_resumeTransmit(const radio_unit_t radio,
+                                  radio_task_object_t *rto) {
+  Si446x_conditional_init(radio);
+  Si446x_terminateReceive(radio);
+  Si446x_setBandParameters(radio, rto->base_frequency, rto->step_hz);
+  if(rto->type == MOD_2FSK)
+    Si446x_setModem2FSK_TX(radio, rto->tx_speed);
+  else
+    Si446x_setModemAFSK_TX(radio);
+}
+
 /*
  * Simple AFSK send thread with minimized buffering and burst send capability.
  * Uses an iterator to size NRZI output and allocate suitable size buffer.
@@ -1278,6 +1292,9 @@ THD_FUNCTION(bloc_si_fifo_feeder_afsk, arg) {
    */
   radio_squelch_t rssi = rto->squelch;
 
+  /* Packets of the chain sent so far. */
+  uint16_t sent = 0;
+
   do {
 
     /*
@@ -1311,6 +1328,19 @@ THD_FUNCTION(bloc_si_fifo_feeder_afsk, arg) {
       chThdExit(MSG_ERROR);
       /* We never arrive here. */
     }
+
+    /* Check the airtime budget. Low priority packets may be deferred. */
+    msg_t budget = pktWaitTransmitAirtime(rto, (uint32_t)all * 8);
+    if(budget == MSG_TIMEOUT) {
+      TRACE_WARN("SI   > AFSK TX airtime budget exhausted, %s packets dropped",
+                 pktGetTransmitClassName(rto->tx_class));
+      pktReleaseBufferChain(pp);
+      exit_msg = MSG_ERROR;
+      break;
+    }
+    if(budget == MSG_RESET)
+      Si446x_resumeTransmit(radio, rto);
+
     /* Allocate buffer and perform NRZI encoding. */
     uint8_t layer0[all];
     pktStreamEncodingIterator(&iterator, layer0, all);
@@ -1410,6 +1440,13 @@ THD_FUNCTION(bloc_si_fifo_feeder_afsk, arg) {
     /* No CCA on subsequent packet sends. */
     rssi = PKT_SI446X_NO_CCA_RSSI;
 
+    TRACE_EVENT("SI   > AFSK TX sent %d samples, FIFO free high water %d,"
+                " exit %d", all, lower, exit_msg);
+
+    /* Account airtime of the NRZI bits (before up-sampling). */
+    if(exit_msg == MSG_OK)
+      pktAddTransmitAirtime(rto, ((uint32_t)all * 8) / SAMPLES_PER_BAUD);
+
     if(lower > (free / 2)) {
       /*
        *  Warn when free level is more than 50% of FIFO size.
@@ -1430,11 +1467,30 @@ THD_FUNCTION(bloc_si_fifo_feeder_afsk, arg) {
 
     /* Process next packet. */
     pp = np;
+
+    /*
+     * Let a higher priority transmit have the radio between packets.
+     * Then listen for receive traffic so RX is not deaf during bursts.
+     * If the radio was yielded or listened it has to be set up again.
+     */
+    if(pp != NULL) {
+      bool setup = pktYieldRadioTransmit(radio);
+      if(pktListenRadioTransmit(radio, ++sent)) {
+        /* Check for a clear channel again after listening. */
+        rssi = rto->squelch;
+        setup = true;
+      }
+      if(setup)
+        Si446x_resumeTransmit(radio, rto);
+    }
   } while(pp != NULL);
 
   /* Save status in case a callback requires it. */
   rto->result = exit_msg;
 
+  /* Resume receive now rather than when the radio manager gets to it. */
+  pktResumeRadioReceive(radio);
+
   /* Finished send so schedule thread memory and task object release. */
   pktLLDradioSendComplete(rto, chThdGetSelfX());
 
@@ -1460,7 +1516,7 @@ bool Si446x_blocSendAFSK(radio_task_object_t *rt) {
     afsk_feeder_thd = chThdCreateFromHeap(NULL,
                 THD_WORKING_AREA_SIZE(SI_AFSK_FIFO_MIN_FEEDER_WA_SIZE),
                 tx_thd_name,
-                NORMALPRIO - 10,
+                pktGetTransmitPriority(rt->tx_class),
                 bloc_si_fifo_feeder_afsk,
                 rt);
 
@@ -1538,6 +1594,9 @@ THD_FUNCTION(bloc_si_fifo_feeder_fsk, arg) {
    */
   radio_squelch_t rssi = rto->squelch;
 
+  /* Packets of the chain sent so far. */
+  uint16_t sent = 0;
+
   do {
     /*
      * Set NRZI encoding format.
@@ -1572,6 +1631,19 @@ THD_FUNCTION(bloc_si_fifo_feeder_fsk, arg) {
       chThdExit(MSG_ERROR);
       /* We never arrive here. */
     }
+
+    /* Check the airtime budget. Low priority packets may be deferred. */
+    msg_t budget = pktWaitTransmitAirtime(rto, (uint32_t)all * 8);
+    if(budget == MSG_TIMEOUT) {
+      TRACE_WARN("SI   > 2FSK TX airtime budget exhausted, %s packets dropped",
+                 pktGetTransmitClassName(rto->tx_class));
+      pktReleaseBufferChain(pp);
+      exit_msg = MSG_ERROR;
+      break;
+    }
+    if(budget == MSG_RESET)
+      Si446x_resumeTransmit(radio, rto);
+
     /* Allocate buffer and perform NRZI encoding. */
     uint8_t layer0[all];
 
@@ -1663,6 +1735,12 @@ THD_FUNCTION(bloc_si_fifo_feeder_fsk, arg) {
     /* No CCA on subsequent packet sends. */
     rssi = PKT_SI446X_NO_CCA_RSSI;
 
+    TRACE_EVENT("SI   > 2FSK TX sent %d bytes, FIFO free high water %d,"
+                " exit %d", all, lower, exit_msg);
+
+    if(exit_msg == MSG_OK)
+      pktAddTransmitAirtime(rto, (uint32_t)all * 8);
+
     if(lower > (free / 2)) {
       /* Warn when free level is > 50% of FIFO size. */
       TRACE_WARN("SI   > AFSK TX FIFO dropped below safe threshold %i", lower);
@@ -1681,11 +1759,30 @@ THD_FUNCTION(bloc_si_fifo_feeder_fsk, arg) {
 
     /* Process next packet. */
     pp = np;
+
+    /*
+     * Let a higher priority transmit have the radio between packets.
+     * Then listen for receive traffic so RX is not deaf during bursts.
+     * If the radio was yielded or listened it has to be set up again.
+     */
+    if(pp != NULL) {
+      bool setup = pktYieldRadioTransmit(radio);
+      if(pktListenRadioTransmit(radio, ++sent)) {
+        /* Check for a clear channel again after listening. */
+        rssi = rto->squelch;
+        setup = true;
+      }
+      if(setup)
+        Si446x_resumeTransmit(radio, rto);
+    }
   } while(pp != NULL);
 
   /* Save status in case a callback requires it. */
   rto->result = exit_msg;
 
+  /* Resume receive now rather than when the radio manager gets to it. */
+  pktResumeRadioReceive(radio);
+
   /* Finished send so schedule thread memory and task object release. */
   pktLLDradioSendComplete(rto, chThdGetSelfX());
 
@@ -1713,7 +1810,7 @@ bool Si446x_blocSend2FSK(radio_task_object_t *rt) {
   fsk_feeder_thd = chThdCreateFromHeap(NULL,
               THD_WORKING_AREA_SIZE(SI_FSK_FIFO_FEEDER_WA_SIZE),
               tx_thd_name,
-              NORMALPRIO - 10,
+              pktGetTransmitPriority(rt->tx_class),
               bloc_si_fifo_feeder_fsk,
               rt);
 
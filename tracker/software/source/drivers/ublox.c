@@ -40,11 +40,38 @@ const char *gps_get_model_name(uint8_t index) {
   return model[index];
 }
 
+/*
+ * UBX receiver.
+ * A receiver thread blocks on the interrupt fed UART input queue and parses
+ * the UBX stream as it arrives. Decoded ACK, NAV-PVT and NAV-SVINFO messages
+ * are stored in shared state and announced on gps_rx_event. Callers wait on
+ * the event instead of polling the UART.
+ */
+static EVENTSOURCE_DECL(gps_rx_event);
+static MUTEX_DECL(gps_mtx);
+static thread_t *gps_rx_thd;
+
+static struct {
+	bool received;
+	bool ack;
+	uint8_t class_id;
+	uint8_t msg_id;
+} gps_ack;
+
+static gpsFix_t gps_fix;
+static bool gps_fix_valid;
+static gps_svinfo_t gps_svinfo;
+static bool gps_svinfo_valid;
+
 /**
   * Transmits a string of bytes to the GPS
   */
 void gps_transmit_string(uint8_t *cmd, uint8_t length) {
   gps_calc_ubx_csum(cmd, length);
+  /* Forget the previous ACK so only the reply to this command is seen. */
+  chMtxLock(&gps_mtx);
+  gps_ack.received = false;
+  chMtxUnlock(&gps_mtx);
 #if UBLOX_USE_I2C == TRUE
   I2C_writeN(UBLOX_MAX_ADDRESS, cmd, length);
 #elif defined(UBLOX_UART_CONNECTED)
@@ -54,9 +81,10 @@ void gps_transmit_string(uint8_t *cmd, uint8_t length) {
 
 /**
   * Receives a single byte from the GPS and assigns to supplied pointer.
+  * Waits up to timeout for a byte to arrive.
   * Returns false is there is no byte available else true
   */
-bool gps_receive_byte(uint8_t *data) {
+static bool gps_receive_byte(uint8_t *data, sysinterval_t timeout) {
 #if UBLOX_USE_I2C == TRUE
 	uint16_t len;
 	I2C_read16(UBLOX_MAX_ADDRESS, 0xFD, &len);
@@ -64,109 +92,143 @@ bool gps_receive_byte(uint8_t *data) {
 		I2C_read8(UBLOX_MAX_ADDRESS, 0xFF, data);
 		return true;
 	}
+	chThdSleep(timeout < TIME_MS2I(10) ? timeout : TIME_MS2I(10));
 #elif defined(UBLOX_UART_CONNECTED)
-	return sdReadTimeout(&SD5, data, 1, TIME_IMMEDIATE);
+	msg_t msg = sdGetTimeout(&SD5, timeout);
+	if(msg >= MSG_OK) {
+		*data = (uint8_t)msg;
+		return true;
+	}
 #else
     (void) data;
+    chThdSleep(timeout);
 #endif
     return false;
 }
 
 /**
-  * gps_receive_ack
-  *
-  * waits for transmission of an ACK/NAK message from the GPS.
-  *
-  * returns 1 if ACK was received, 0 if NAK was received or timeout
-  *
+  * Decodes a NAV-PVT payload into the shared fix.
+  * NAV-PVT flags bit 0 (gnssFixOK) replaces the gpsFixOk flag of NAV-STATUS.
   */
-uint8_t gps_receive_ack(uint8_t class_id, uint8_t msg_id, uint16_t timeout) {
-	int match_count = 0;
-	int msg_ack = 0;
-	uint8_t rx_byte;
-	uint8_t ack[] = {0xB5, 0x62, 0x05, 0x01, 0x02, 0x00, 0x00, 0x00};
-	uint8_t nak[] = {0xB5, 0x62, 0x05, 0x00, 0x02, 0x00, 0x00, 0x00};
-	ack[6] = class_id;
-	nak[6] = class_id;
-	ack[7] = msg_id;
-	nak[7] = msg_id;
-
-	// runs until ACK/NAK packet is received
-	sysinterval_t sTimeout = chVTGetSystemTimeX() + TIME_MS2I(timeout);
-	while(sTimeout >= chVTGetSystemTimeX()) {
+static void gps_decode_nav_pvt(gpsFix_t *fix, uint8_t *navpvt) {
+      // Extract data from message
+      fix->fixOK = navpvt[21] & 0x1;
+      fix->pdop = navpvt[76] + (navpvt[77] << 8);
 
-		// Receive one byte
-		if(!gps_receive_byte(&rx_byte)) {
-			chThdSleep(TIME_MS2I(10));
-			continue;
-		}
+      fix->num_svs = navpvt[23];
+      fix->type = navpvt[20];
 
-		// Process one byte
-		if (rx_byte == ack[match_count] || rx_byte == nak[match_count]) {
-			if (match_count == 3) {	/* test ACK/NAK byte */
-				if (rx_byte == ack[match_count]) {
-					msg_ack = 1;
-				} else {
-					msg_ack = 0;
-				}
-			}
-			if (match_count == 7) { 
-				return msg_ack;
-			}
-			match_count++;
-		} else {
-			match_count = 0;
-		}
+      fix->time.year = navpvt[4] + (navpvt[5] << 8);
+      fix->time.month = navpvt[6];
+      fix->time.day = navpvt[7];
+      fix->time.hour = navpvt[8];
+      fix->time.minute = navpvt[9];
+      fix->time.second = navpvt[10];
+
+      fix->lat = (int32_t) (
+              (uint32_t)(navpvt[28])
+              + ((uint32_t)(navpvt[29]) << 8)
+              + ((uint32_t)(navpvt[30]) << 16)
+              + ((uint32_t)(navpvt[31]) << 24)
+              );
+      fix->lon = (int32_t) (
+              (uint32_t)(navpvt[24])
+              + ((uint32_t)(navpvt[25]) << 8)
+              + ((uint32_t)(navpvt[26]) << 16)
+              + ((uint32_t)(navpvt[27]) << 24)
+              );
+      int32_t alt_tmp = (((int32_t)
+              ((uint32_t)(navpvt[36])
+                  + ((uint32_t)(navpvt[37]) << 8)
+                  + ((uint32_t)(navpvt[38]) << 16)
+                  + ((uint32_t)(navpvt[39]) << 24))
+              ) / 1000);
+      if (alt_tmp <= 0) {
+          fix->alt = 1;
+      } else if (alt_tmp > 50000) {
+          fix->alt = 50000;
+      } else {
+          fix->alt = (uint16_t)alt_tmp;
+      }
+      fix->model = gps_model;
+}
 
+/**
+  * Handles a complete UBX message with valid checksum
+  */
+static void gps_dispatch(uint8_t class_id, uint8_t msg_id, uint8_t *payload, uint16_t len) {
+	eventflags_t flags = 0;
+
+	chMtxLock(&gps_mtx);
+	if(class_id == 0x05 && len == 2) { // ACK-ACK / ACK-NAK
+		gps_ack.received = true;
+		gps_ack.ack = msg_id == 0x01;
+		gps_ack.class_id = payload[0];
+		gps_ack.msg_id = payload[1];
+		flags = GPS_EVT_ACK;
+	} else if(class_id == 0x01 && msg_id == 0x07 && len >= 92) { // NAV-PVT
+		gps_decode_nav_pvt(&gps_fix, payload);
+		gps_fix_valid = true;
+		flags = GPS_EVT_FIX;
+		if(isGPSLocked(&gps_fix))
+			flags |= GPS_EVT_LOCK;
+	} else if(class_id == 0x01 && msg_id == 0x30) { // NAV-SVINFO
+		memcpy(&gps_svinfo, payload, len < sizeof(gps_svinfo) ? len : sizeof(gps_svinfo));
+		if(gps_svinfo.numCh > GPS_MAX_SV_CHANNELS)
+			gps_svinfo.numCh = GPS_MAX_SV_CHANNELS;
+		gps_svinfo_valid = true;
+		flags = GPS_EVT_SVINFO;
 	}
+	chMtxUnlock(&gps_mtx);
 
-	return 0;
+	if(flags)
+		chEvtBroadcastFlags(&gps_rx_event, flags);
 }
 
 /**
-  * gps_receive_payload
-  *
-  * retrieves the payload of a packet with a given class and message-id with the retrieved length.
-  * the caller has to ensure suitable buffer length!
-  *
-  * returns the length of the payload
-  *
+  * Receiver thread. Parses the UBX stream and verifies the checksum of
+  * each message before it is dispatched.
   */
-uint16_t gps_receive_payload(uint8_t class_id, uint8_t msg_id,
-                             unsigned char *payload, size_t size,
-                             uint16_t timeout) {
-	uint8_t rx_byte;
-	enum {UBX_A, UBX_B, CLASSID, MSGID, LEN_A, LEN_B, PAYLOAD} state = UBX_A;
+static THD_FUNCTION(gps_receiver, arg) {
+	(void)arg;
+
+	static uint8_t payload[GPS_UBX_MAX_PAYLOAD];
+	enum {UBX_A, UBX_B, CLASSID, MSGID, LEN_A, LEN_B, PAYLOAD, CK_A, CK_B} state = UBX_A;
+	uint8_t class_id = 0, msg_id = 0;
 	uint16_t payload_cnt = 0;
 	uint16_t payload_len = 0;
+	uint8_t ck_a = 0, ck_b = 0;
 
-	sysinterval_t sNow = chVTGetSystemTime();
-
-	while(chVTIsSystemTimeWithin(sNow, sNow + TIME_MS2I(timeout))) {
+	while(!chThdShouldTerminateX()) {
+		uint8_t rx_byte;
 
 		// Receive one byte
-      if(!gps_receive_byte(&rx_byte)) {
-			chThdSleep(TIME_MS2I(1));
+		if(!gps_receive_byte(&rx_byte, TIME_MS2I(100)))
 			continue;
-		}
 
 		// Process one byte
+		if(state >= CLASSID && state <= PAYLOAD)
+			ck_b += (ck_a += rx_byte);
+
 		switch (state) {
 			case UBX_A:
-				if(rx_byte == 0xB5)	   state = UBX_B;
-				//else 			state = UBX_A;
+				if(rx_byte == 0xB5)	state = UBX_B;
 				break;
 			case UBX_B:
-				if(rx_byte == 0x62)	    state = CLASSID;
-				else			state = UBX_A;
+				if(rx_byte == 0x62) {
+					state = CLASSID;
+					ck_a = ck_b = 0;
+				} else {
+					state = UBX_A;
+				}
 				break;
 			case CLASSID:
-				if(rx_byte == class_id) state = MSGID;
-				else			state = UBX_A;
+				class_id = rx_byte;
+				state = MSGID;
 				break;
 			case MSGID:
-				if(rx_byte == msg_id)	state = LEN_A;
-				else			state = UBX_A;
+				msg_id = rx_byte;
+				state = LEN_A;
 				break;
 			case LEN_A:
 				payload_len = rx_byte;
@@ -174,21 +236,69 @@ uint16_t gps_receive_payload(uint8_t class_id, uint8_t msg_id,
 				break;
 			case LEN_B:
 				payload_len |= ((uint16_t)rx_byte << 8);
-				state = PAYLOAD;
+				payload_cnt = 0;
+				if(payload_len > sizeof(payload))
+					state = UBX_A; // Too long, resynchronize
+				else
+					state = payload_len ? PAYLOAD : CK_A;
 				break;
 			case PAYLOAD:
 				payload[payload_cnt++] = rx_byte;
-				//payload_cnt++;
-                if(payload_cnt == payload_len)
-                  return payload_len;
-				if(payload_cnt > size)
-				  return 0;
+				if(payload_cnt == payload_len)
+					state = CK_A;
+				break;
+			case CK_A:
+				state = rx_byte == ck_a ? CK_B : UBX_A;
+				break;
+			case CK_B:
+				if(rx_byte == ck_b)
+					gps_dispatch(class_id, msg_id, payload, payload_len);
+				state = UBX_A;
 				break;
 			default:
 				state = UBX_A;
 		}
 	}
-	return 0;
+}
+
+/**
+  * Waits for a receiver event until timeout (counted from start) expires.
+  * The listener must be registered before the request is transmitted.
+  * Returns false on timeout.
+  */
+static bool gps_wait_event(systime_t start, sysinterval_t timeout) {
+	sysinterval_t elapsed = chVTTimeElapsedSinceX(start);
+	if(elapsed >= timeout)
+		return false;
+	return chEvtWaitAnyTimeout(GPS_EVT_LISTENER, timeout - elapsed) != 0;
+}
+
+/**
+  * gps_receive_ack
+  *
+  * waits for transmission of an ACK/NAK message from the GPS.
+  *
+  * returns 1 if ACK was received, 0 if NAK was received or timeout
+  *
+  */
+uint8_t gps_receive_ack(uint8_t class_id, uint8_t msg_id, uint16_t timeout) {
+	event_listener_t el;
+	uint8_t msg_ack = 0;
+	bool received = false;
+
+	chEvtRegisterMaskWithFlags(&gps_rx_event, &el, GPS_EVT_LISTENER, GPS_EVT_ACK);
+	systime_t start = chVTGetSystemTime();
+	do {
+		chMtxLock(&gps_mtx);
+		if(gps_ack.received && gps_ack.class_id == class_id && gps_ack.msg_id == msg_id) {
+			received = true;
+			msg_ack = gps_ack.ack;
+		}
+		chMtxUnlock(&gps_mtx);
+	} while(!received && gps_wait_event(start, TIME_MS2I(timeout)));
+	chEvtUnregister(&gps_rx_event, &el);
+
+	return msg_ack;
 }
 
 /**
@@ -200,11 +310,31 @@ bool gps_get_sv_info(gps_svinfo_t *svinfo, size_t size) {
   if(!gps_enabled)
     return false;
 
+  event_listener_t el;
+  bool received = false;
+
+  chMtxLock(&gps_mtx);
+  gps_svinfo_valid = false;
+  chMtxUnlock(&gps_mtx);
+
+  chEvtRegisterMaskWithFlags(&gps_rx_event, &el, GPS_EVT_LISTENER, GPS_EVT_SVINFO);
+
   // Transmit request
   uint8_t navsvinfo_req[] = {0xB5, 0x62, 0x01, 0x30, 0x00, 0x00, 0x00, 0x00};
   gps_transmit_string(navsvinfo_req, sizeof(navsvinfo_req));
 
-  if(!gps_receive_payload(0x01, 0x30, (unsigned char*)svinfo, size, 3000)) { // Receive request
+  systime_t start = chVTGetSystemTime();
+  do {
+    chMtxLock(&gps_mtx);
+    if(gps_svinfo_valid) {
+      memcpy(svinfo, &gps_svinfo, size < sizeof(gps_svinfo) ? size : sizeof(gps_svinfo));
+      received = true;
+    }
+    chMtxUnlock(&gps_mtx);
+  } while(!received && gps_wait_event(start, TIME_MS2I(3000)));
+  chEvtUnregister(&gps_rx_event, &el);
+
+  if(!received) {
     TRACE_ERROR("GPS  > NAV-SVINFO Polling FAILED");
     return false;
   }
@@ -214,79 +344,69 @@ bool gps_get_sv_info(gps_svinfo_t *svinfo, size_t size) {
 /**
   * gps_get_fix
   *
-  * retrieves a GPS fix from the module.
+  * retrieves the most recent GPS fix decoded by the receiver thread.
   * if validity flag is not set, date/time and position/altitude are
   * assumed not to be reliable!
   *
+  * returns false if no NAV-PVT has been received since GPS was switched on
   */
 bool gps_get_fix(gpsFix_t *fix) {
-	static uint8_t navpvt[128];
-	static uint8_t navstatus[32];
-
-	// Transmit request
-	uint8_t navpvt_req[] = {0xB5, 0x62, 0x01, 0x07, 0x00, 0x00, 0x00, 0x00};
-	gps_transmit_string(navpvt_req, sizeof(navpvt_req));
-
-	if(!gps_receive_payload(0x01, 0x07, navpvt, sizeof(navpvt), 3000)) { // Receive request
-		TRACE_ERROR("GPS  > NAV-PVT Polling FAILED");
-		return false;
-	}
-
-	uint8_t navstatus_req[] = {0xB5, 0x62, 0x01, 0x03, 0x00, 0x00, 0x00, 0x00};
-	gps_transmit_string(navstatus_req, sizeof(navstatus_req));
+	chMtxLock(&gps_mtx);
+	bool valid = gps_fix_valid;
+	if(valid)
+		*fix = gps_fix;
+	chMtxUnlock(&gps_mtx);
+	return valid;
+}
 
-	if(!gps_receive_payload(0x01, 0x03, navstatus, sizeof(navstatus), 3000)) { // Receive request
-		TRACE_ERROR("GPS  > NAV-STATUS Polling FAILED");
-		return false;
+/**
+  * gps_wait_fix
+  *
+  * waits until the receiver decodes a fix which meets the lock criteria
+  * (isGPSLocked) or timeout expires. The fix is handed over as soon as
+  * the NAV-PVT message has been received.
+  *
+  * returns true if a locked fix was retrieved
+  */
+bool gps_wait_fix(gpsFix_t *fix, sysinterval_t timeout) {
+	event_listener_t el;
+	bool locked;
+
+	chEvtRegisterMaskWithFlags(&gps_rx_event, &el, GPS_EVT_LISTENER, GPS_EVT_LOCK);
+	systime_t start = chVTGetSystemTime();
+	while(!(locked = gps_get_fix(fix) && isGPSLocked(fix))
+	      && gps_wait_event(start, timeout));
+	chEvtUnregister(&gps_rx_event, &el);
+
+	if(locked) {
+		TRACE_INFO("GPS  > Fix OK time=%04d-%02d-%02d %02d:%02d:%02d lat=%d.%05d lon=%d.%05d alt=%dm sats=%d fixOK=%d pDOP=%02d.%02d model=%s",
+			fix->time.year, fix->time.month, fix->time.day, fix->time.hour, fix->time.minute, fix->time.second,
+			fix->lat/10000000, (fix->lat > 0 ? 1:-1)*(fix->lat/100)%100000, fix->lon/10000000, (fix->lon > 0 ? 1:-1)*(fix->lon/100)%100000,
+			fix->alt, fix->num_svs, fix->fixOK, fix->pdop/100, fix->pdop%100, gps_get_model_name(fix->model)
+		);
 	}
+	return locked;
+}
 
-      // Extract data from message
-      fix->fixOK = navstatus[5] & 0x1;
-      fix->pdop = navpvt[76] + (navpvt[77] << 8);
-
-      fix->num_svs = navpvt[23];
-      fix->type = navpvt[20];
-
-      fix->time.year = navpvt[4] + (navpvt[5] << 8);
-      fix->time.month = navpvt[6];
-      fix->time.day = navpvt[7];
-      fix->time.hour = navpvt[8];
-      fix->time.minute = navpvt[9];
-      fix->time.second = navpvt[10];
-
-      fix->lat = (int32_t) (
-              (uint32_t)(navpvt[28])
-              + ((uint32_t)(navpvt[29]) << 8)
-              + ((uint32_t)(navpvt[30]) << 16)
-              + ((uint32_t)(navpvt[31]) << 24)
-              );
-      fix->lon = (int32_t) (
-              (uint32_t)(navpvt[24])
-              + ((uint32_t)(navpvt[25]) << 8)
-              + ((uint32_t)(navpvt[26]) << 16)
-              + ((uint32_t)(navpvt[27]) << 24)
-              );
-      int32_t alt_tmp = (((int32_t)
-              ((uint32_t)(navpvt[36])
-                  + ((uint32_t)(navpvt[37]) << 8)
-                  + ((uint32_t)(navpvt[38]) << 16)
-                  + ((uint32_t)(navpvt[39]) << 24))
-              ) / 1000);
-      if (alt_tmp <= 0) {
-          fix->alt = 1;
-      } else if (alt_tmp > 50000) {
-          fix->alt = 50000;
-      } else {
-          fix->alt = (uint16_t)alt_tmp;
-      }
-      fix->model = gps_model;
-	TRACE_INFO("GPS  > Polling OK time=%04d-%02d-%02d %02d:%02d:%02d lat=%d.%05d lon=%d.%05d alt=%dm sats=%d fixOK=%d pDOP=%02d.%02d model=%s",
-		fix->time.year, fix->time.month, fix->time.day, fix->time.hour, fix->time.minute, fix->time.second,
-		fix->lat/10000000, (fix->lat > 0 ? 1:-1)*(fix->lat/100)%100000, fix->lon/10000000, (fix->lon > 0 ? 1:-1)*(fix->lon/100)%100000,
-		fix->alt, fix->num_svs, fix->fixOK, fix->pdop/100, fix->pdop%100, gps_get_model_name(fix->model)
-	);
+/**
+  * gps_enable_nav_pvt_output
+  *
+  * tells the GPS to output NAV-PVT with every navigation solution so that
+  * fixes arrive without being polled.
+  *
+  * returns ACK/NAK result
+  *
+  */
+uint8_t gps_enable_nav_pvt_output(void) {
+	uint8_t msgrate[] = {
+		0xB5, 0x62, 0x06, 0x01, 0x03, 0x00,	// UBX-CFG-MSG
+		0x01, 0x07,							// NAV-PVT
+		0x01,								// rate (every solution)
+		0x00, 0x00							// CRC place holders
+	};
 
-	return true;
+	gps_transmit_string(msgrate, sizeof(msgrate));
+	return gps_receive_ack(0x06, 0x01, 1000);
 }
 
 /**
@@ -615,6 +735,19 @@ bool GPS_Init() {
 	chThdSleep(TIME_S2I(1));
 
 	gps_model = GPS_MODEL_PORTABLE;
+
+	// Start UBX receiver
+	chMtxLock(&gps_mtx);
+	gps_fix_valid = false;
+	chMtxUnlock(&gps_mtx);
+	if(gps_rx_thd == NULL) {
+		gps_rx_thd = chThdCreateFromHeap(NULL, THD_WORKING_AREA_SIZE(1024), "GPS", NORMALPRIO + 1, gps_receiver, NULL);
+		if(gps_rx_thd == NULL) {
+			TRACE_ERROR("GPS  > Could not start UBX receiver");
+			return false;
+		}
+	}
+
 	// Configure GPS
 	TRACE_INFO("GPS  > Transmit config to GPS");
 
@@ -627,6 +760,14 @@ bool GPS_Init() {
 		TRACE_ERROR("GPS  > Communication Error [disable NMEA]");
 		return false;
 	}
+	cntr = 3;
+	while((status = gps_enable_nav_pvt_output()) == false && cntr--);
+	if(status) {
+		TRACE_INFO("GPS  > ... Enable NAV-PVT output OK");
+	} else {
+		TRACE_ERROR("GPS  > Communication Error [enable NAV-PVT]");
+		return false;
+	}
     gps_enabled = true;
 	return true;
 }
@@ -640,6 +781,13 @@ void GPS_Deinit(void)
 	TRACE_INFO("GPS  > Power down GPS");
 	palClearLine(LINE_GPS_EN);
 
+	// Stop UBX receiver
+	if(gps_rx_thd != NULL) {
+		chThdTerminate(gps_rx_thd);
+		chThdWait(gps_rx_thd);
+		gps_rx_thd = NULL;
+	}
+
 #if defined(UBLOX_UART_CONNECTED) && UBLOX_USE_I2C == FALSE
     // Stop and deinit UART
     TRACE_INFO("GPS  > Stop GPS UART");
@@ -61,6 +61,16 @@ typedef enum {
 #warning "UBLOX has no I2C or UART communications enabled"
 #endif
 
+/* Largest UBX payload accepted by the receiver (NAV-SVINFO with all channels). */
+#define GPS_UBX_MAX_PAYLOAD     (8 + 12 * GPS_MAX_SV_CHANNELS)
+
+/* Receiver event flags and the event used by waiting threads. */
+#define GPS_EVT_ACK             0x01
+#define GPS_EVT_FIX             0x02
+#define GPS_EVT_LOCK            0x04
+#define GPS_EVT_SVINFO          0x08
+#define GPS_EVT_LISTENER        EVENT_MASK(8)
+
 #define isGPSLocked(pos) ((pos)->type == 3 && (pos)->num_svs >= 4 && (pos)->fixOK == true)
 
 typedef struct {
@@ -104,6 +114,7 @@ uint8_t gps_set_power_save(void);
 uint8_t gps_power_save(int on);
 //uint8_t gps_save_settings(void);
 bool gps_get_fix(gpsFix_t *fix);
+bool gps_wait_fix(gpsFix_t *fix, sysinterval_t timeout);
 bool gps_get_sv_info(gps_svinfo_t *svinfo, size_t size);
 bool GPS_Init(void);
 void GPS_Deinit(void);
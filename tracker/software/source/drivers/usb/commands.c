@@ -86,6 +86,14 @@ void usb_cmd_ccm_heap(BaseSequentialStream *chp, int argc, char *argv[]) {
   chprintf(chp, "heap free total  : %u bytes"SHELL_NEWLINE_STR, total);
   chprintf(chp, "heap free largest: %u bytes"SHELL_NEWLINE_STR, largest);
 
+  pkt_buffer_stats_t stats;
+  pktGetPacketBufferStats(&stats);
+  chprintf(chp, SHELL_NEWLINE_STR"Packet buffer pool"SHELL_NEWLINE_STR);
+  chprintf(chp, "buffers total    : %u"SHELL_NEWLINE_STR, NUMBER_COMMON_PKT_BUFFERS);
+  chprintf(chp, "buffers in use   : %u"SHELL_NEWLINE_STR, stats.in_use);
+  chprintf(chp, "buffers peak     : %u"SHELL_NEWLINE_STR, stats.peak);
+  chprintf(chp, "allocation fails : %u"SHELL_NEWLINE_STR, stats.fails);
+
   extern memory_heap_t *ccm_heap;
   if(ccm_heap == NULL) {
     chprintf(chp, SHELL_NEWLINE_STR"CCM Heap not enabled"SHELL_NEWLINE_STR);
@@ -291,7 +299,8 @@ void usb_cmd_send_aprs_message(BaseSequentialStream *chp, int argc, char *argv[]
                     0,
                     conf_sram.aprs.tx.radio_conf.pwr,
                     conf_sram.aprs.tx.radio_conf.mod,
-                    conf_sram.aprs.tx.radio_conf.cca);
+                    conf_sram.aprs.tx.radio_conf.cca,
+                    PKT_TX_CLASS_TELEMETRY);
 
 	chprintf(chp, "Message sent!\r\n");
 }
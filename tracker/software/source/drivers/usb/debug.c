@@ -2,8 +2,7 @@
 #include "hal.h"
 #include "debug.h"
 #include "portab.h"
-
-mutex_t mtx; // Used internal to synchronize multiple chprintf in debug.h
+#include "memstreams.h"
 
 char error_list[ERROR_LIST_SIZE][ERROR_LIST_LENGTH];
 uint8_t error_counter;
@@ -21,47 +20,243 @@ uint8_t usb_trace_level = USB_TRACE_LEVEL; // Set in makefile UDEFS
 uint8_t usb_trace_level = 2; // Level: Errors + Warnings
 #endif
 
+/*
+ * Trace ring buffer.
+ * Producers reserve a slot (head) inside a short critical section and then
+ * format into it without holding any lock. The slot is published by setting
+ * its ready flag. The writer thread drains slots in order (tail).
+ * A producer never waits. If the buffer is full the message is dropped and
+ * counted instead.
+ */
+static trace_msg_t trace_buffer[TRACE_BUFFER_SLOTS];
+static uint32_t trace_head;		// Next slot to be reserved by a producer
+static uint32_t trace_tail;		// Next slot to be written out
+static uint32_t trace_dropped;	// Messages lost since last report
+static thread_t *trace_thd;
 
-void debug_init(void) {
-	chMtxObjectInit(&mtx);
+/**
+ * Format into a fixed size buffer from a va_list (chprintf has no vsnprintf)
+ */
+static void debug_vformat(char *str, size_t size, const char *format, va_list args)
+{
+	MemoryStream ms;
+	msObjectInit(&ms, (uint8_t*)str, size-1, 0);
+	chvprintf((BaseSequentialStream*)&ms, format, args);
+	str[ms.eos] = 0;
+}
+
+/**
+ * Formats a buffered message into a complete trace line
+ */
+static void debug_format_line(char *str, size_t size, const trace_msg_t *msg)
+{
+	MemoryStream ms;
+	BaseSequentialStream *chp = (BaseSequentialStream*)&ms;
+	msObjectInit(&ms, (uint8_t*)str, size-1, 0);
+
+	if(TRACE_TIME) {
+		chprintf(chp, "[%8d.%03d]", msg->time/CH_CFG_ST_FREQUENCY, (msg->time*1000/CH_CFG_ST_FREQUENCY)%1000);
+	}
+	chprintf(chp, "[%s]", msg->type);
+	if(TRACE_FILE) {
+		const char *file = strrchr(msg->file, '/') ? strrchr(msg->file, '/') + 1 : msg->file;
+		chprintf(chp, "[%12s %04d]", file, msg->line);
+	}
+	if(msg->fmt != NULL) {
+		// Deferred formatting of a binary event
+		chprintf(chp, " ");
+		chprintf(chp, msg->fmt, msg->args[0], msg->args[1], msg->args[2], msg->args[3]);
+	} else {
+		chprintf(chp, " %s", msg->text);
+	}
+	str[ms.eos] = 0;
+}
+
+#if TRACE_BINARY
+static uint8_t* debug_put32(uint8_t *p, uint32_t value)
+{
+	*p++ = value;
+	*p++ = value >> 8;
+	*p++ = value >> 16;
+	*p++ = value >> 24;
+	return p;
+}
+
+/**
+ * Writes a message as binary record. Events are sent unformatted, the host
+ * resolves the format string and file name addresses from the ELF file.
+ */
+static void debug_write_binary(BaseSequentialStream *chp, const trace_msg_t *msg, const char *line)
+{
+	uint8_t rec[16 + TRACE_EVENT_ARGS*4 + TRACE_MSG_LENGTH];
+	uint8_t *p = rec;
+
+	*p++ = TRACE_BIN_SYNC1;
+	*p++ = TRACE_BIN_SYNC2;
+	if(msg->fmt != NULL) {
+		*p++ = msg->nargs;
+		p = debug_put32(p, msg->time);
+		p = debug_put32(p, (uint32_t)msg->file);
+		*p++ = msg->line;
+		*p++ = msg->line >> 8;
+		p = debug_put32(p, (uint32_t)msg->fmt);
+		for(uint8_t i=0; i<msg->nargs; i++)
+			p = debug_put32(p, msg->args[i]);
+	} else {
+		size_t len = strlen(line);
+		if(len > TRACE_MSG_LENGTH-1)
+			len = TRACE_MSG_LENGTH-1;
+		*p++ = TRACE_BIN_TEXT;
+		p = debug_put32(p, msg->time);
+		*p++ = len;
+		memcpy(p, line, len);
+		p += len;
+	}
+
+	uint8_t chk = 0;
+	for(uint8_t *c = &rec[2]; c < p; c++)
+		chk ^= *c;
+	*p++ = chk;
+
+	streamWrite(chp, rec, p - rec);
+}
+#endif
+
+/**
+ * Writer thread draining the trace buffer to USB console and SD3.
+ * Binary events are formatted here (or on the host if TRACE_BINARY is set).
+ * Runs at low priority so slow serial output never stalls the producers.
+ */
+static THD_FUNCTION(debug_writer, arg)
+{
+	(void)arg;
+
+	while(true)
+	{
+		chEvtWaitAny(TRACE_EVT_POSTED);
+
+		// Report messages lost while the buffer was full
+		chSysLock();
+		uint32_t dropped = trace_dropped;
+		trace_dropped = 0;
+		chSysUnlock();
+		if(dropped) {
+			if(isConsoleOutputAvailable())
+				chprintf((BaseSequentialStream*)&SDU1, "[WARN ] %d trace messages dropped\r\n", dropped);
+#if !TRACE_BINARY
+			chprintf((BaseSequentialStream*)&SD3, "[WARN ] %d trace messages dropped\r\n", dropped);
+#endif
+		}
+
+		// Drain published slots in order
+		trace_msg_t *msg = &trace_buffer[trace_tail % TRACE_BUFFER_SLOTS];
+		while(msg->ready)
+		{
+			char line[TRACE_MSG_LENGTH + 48];
+			bool console = isConsoleOutputAvailable();
 
+			if(console || !TRACE_BINARY || msg->fmt == NULL)
+				debug_format_line(line, sizeof(line), msg);
+			if(console)
+				chprintf((BaseSequentialStream*)&SDU1, "%s\r\n", line);
+#if TRACE_BINARY
+			debug_write_binary((BaseSequentialStream*)&SD3, msg, line);
+#else
+			chprintf((BaseSequentialStream*)&SD3, "%s\r\n", line);
+#endif
+
+			msg->ready = false;
+			chSysLock();
+			trace_tail++;
+			chSysUnlock();
+			msg = &trace_buffer[trace_tail % TRACE_BUFFER_SLOTS];
+		}
+	}
+}
+
+void debug_init(void) {
 	sdStart(&SD3, &debug_config);
 	palSetLineMode(LINE_IO_TXD, PAL_MODE_ALTERNATE(7));
 	palSetLineMode(LINE_IO_RXD, PAL_MODE_ALTERNATE(7));
+
+	trace_thd = chThdCreateFromHeap(NULL, THD_WORKING_AREA_SIZE(1024), "TRACE", LOWPRIO + 1, debug_writer, NULL);
+}
+
+/**
+ * Reserves a trace slot. Returns NULL (and counts a drop) if the buffer is full.
+ * Can be called from thread or ISR context.
+ */
+trace_msg_t* debug_reserve(void)
+{
+	trace_msg_t *msg = NULL;
+
+	syssts_t sts = chSysGetStatusAndLockX();
+	if(trace_head - trace_tail < TRACE_BUFFER_SLOTS) {
+		msg = &trace_buffer[trace_head % TRACE_BUFFER_SLOTS];
+		trace_head++;
+	} else {
+		trace_dropped++;
+	}
+	chSysRestoreStatusX(sts);
+
+	return msg;
+}
+
+/**
+ * Publishes a previously reserved slot and wakes up the writer thread.
+ */
+void debug_commit(trace_msg_t *msg)
+{
+	syssts_t sts = chSysGetStatusAndLockX();
+	msg->ready = true;
+	if(trace_thd != NULL)
+		chEvtSignalI(trace_thd, TRACE_EVT_POSTED);
+	chSysRestoreStatusX(sts);
 }
 
 void debug_print(char *type, char* filename, uint32_t line, char* format, ...)
 {
-	chMtxLock(&mtx);
+	trace_msg_t *msg = debug_reserve();
+	if(msg == NULL)
+		return;
 
-	uint8_t str[256];
+	msg->time = chVTGetSystemTimeX();
+	msg->type = type;
+	msg->file = filename;
+	msg->line = line;
+	msg->fmt = NULL;
+	msg->nargs = 0;
 
 	va_list args;
 	va_start(args, format);
-	chsnprintf((char*)str, sizeof(str), format, args);
+	debug_vformat(msg->text, sizeof(msg->text), format, args);
 	va_end(args);
 
+	debug_commit(msg);
+}
 
-	if(isConsoleOutputAvailable()) {
-		if(TRACE_TIME) {
-			chprintf((BaseSequentialStream*)&SDU1, "[%8d.%03d]", chVTGetSystemTime()/CH_CFG_ST_FREQUENCY, (chVTGetSystemTime()*1000/CH_CFG_ST_FREQUENCY)%1000);
-		}
-		chprintf((BaseSequentialStream*)&SDU1, "[%s]", type);
-		if(TRACE_FILE) {
-			chprintf((BaseSequentialStream*)&SDU1, "[%12s %04d]", filename, line);
-		}
-		chprintf((BaseSequentialStream*)&SDU1, " %s\r\n", str);
-	}
+/**
+ * Records a binary trace event. No formatting is done by the caller, only the
+ * arguments are copied. Can be called from thread or ISR context.
+ */
+void debug_event(const char *filename, uint32_t line, const char *format, uint32_t nargs, ...)
+{
+	trace_msg_t *msg = debug_reserve();
+	if(msg == NULL)
+		return;
 
-	if(TRACE_TIME) {
-		chprintf((BaseSequentialStream*)&SD3, "[%8d.%03d]", chVTGetSystemTime()/CH_CFG_ST_FREQUENCY, (chVTGetSystemTime()*1000/CH_CFG_ST_FREQUENCY)%1000);
-	}
-	chprintf((BaseSequentialStream*)&SD3, "[%s]", type);
-	if(TRACE_FILE) {
-		chprintf((BaseSequentialStream*)&SD3, "[%12s %04d]", filename, line);
-	}
-	chprintf((BaseSequentialStream*)&SD3, " %s\r\n", str);
+	msg->time = chVTGetSystemTimeX();
+	msg->type = "EVENT";
+	msg->file = filename;
+	msg->line = line;
+	msg->fmt = format;
+	msg->nargs = nargs > TRACE_EVENT_ARGS ? TRACE_EVENT_ARGS : nargs;
 
-	chMtxUnlock(&mtx);
-}
+	va_list args;
+	va_start(args, nargs);
+	for(uint8_t i=0; i<TRACE_EVENT_ARGS; i++)
+		msg->args[i] = i < msg->nargs ? va_arg(args, uint32_t) : 0;
+	va_end(args);
 
+	debug_commit(msg);
+}
@@ -13,6 +13,40 @@
 #define ERROR_LIST_LENGTH	64
 #define ERROR_LIST_SIZE		32
 
+#ifndef TRACE_BUFFER_SLOTS
+#define TRACE_BUFFER_SLOTS	32		/* Number of messages buffered for the writer thread (power of 2) */
+#endif
+#ifndef TRACE_MSG_LENGTH
+#define TRACE_MSG_LENGTH	192		/* Maximum length of a single formatted message */
+#endif
+
+#if (TRACE_BUFFER_SLOTS & (TRACE_BUFFER_SLOTS - 1)) != 0
+#error "TRACE_BUFFER_SLOTS must be a power of 2"
+#endif
+
+#define TRACE_EVT_POSTED	EVENT_MASK(0)
+
+#define TRACE_EVENT_ARGS	4		/* Maximum number of arguments of a binary trace event */
+
+/* Binary trace record framing on the debugging port (see decoder/tracedec.py) */
+#define TRACE_BIN_SYNC1		0xA5
+#define TRACE_BIN_SYNC2		0x5A
+#define TRACE_BIN_TEXT		0xFF	/* Record kind for a formatted text line */
+
+typedef struct {
+	volatile bool	ready;		// Slot formatted and ready to be written out
+	systime_t		time;		// System time when the message was posted
+	const char		*type;
+	const char		*file;
+	uint32_t		line;
+	const char		*fmt;		// Deferred format string of a binary event (NULL for text)
+	uint8_t			nargs;
+	union {
+		uint32_t	args[TRACE_EVENT_ARGS];
+		char		text[TRACE_MSG_LENGTH];
+	};
+} trace_msg_t;
+
 #define __FILENAME__ (strrchr(__FILE__, '/') ? strrchr(__FILE__, '/') + 1 : __FILE__)
 
 extern char error_list[ERROR_LIST_SIZE][ERROR_LIST_LENGTH];
@@ -33,6 +67,17 @@ extern uint8_t usb_trace_level;
 	error_counter = (error_counter+1)%ERROR_LIST_SIZE; \
 }
 
+/*
+ * Binary trace event for hot paths (ISR and timing critical threads).
+ * Only the format string address, the time and up to 4 integer arguments are
+ * recorded. Formatting is deferred to the trace writer thread, or to the host
+ * (decoder/tracedec.py) if TRACE_BINARY is set. The format must be a string
+ * literal since it is referenced, not copied.
+ */
+#define TRACE_NARGS(...) TRACE_NARGS_(__VA_ARGS__, 4, 3, 2, 1, 0)
+#define TRACE_NARGS_(format, a1, a2, a3, a4, n, ...) n
+#define TRACE_EVENT(format, args...) if(usb_trace_level > 4) { debug_event(__FILE__, __LINE__, format, TRACE_NARGS(format, ##args), ##args); }
+
 #if TRACE_TIME && TRACE_FILE
 #define TRACE_TAB "                                               "
 #elif TRACE_TIME && !TRACE_FILE
@@ -64,7 +109,10 @@ static inline heap_header_t *pktSystemCheck(void) {
 #endif
 
 void debug_init(void);
+trace_msg_t* debug_reserve(void);
+void debug_commit(trace_msg_t *msg);
 void debug_print(char *type, char* filename, uint32_t line, char* format, ...);
+void debug_event(const char *filename, uint32_t line, const char *format, uint32_t nargs, ...);
 
 #endif /* __TRACE_H__ */
 
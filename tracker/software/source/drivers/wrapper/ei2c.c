@@ -194,3 +194,17 @@ bool eI2C_read16_LE(uint8_t address, uint8_t reg, uint16_t *val) {
 	return true;
 }
 
+// Burst read of consecutive registers
+bool eI2C_readN(uint8_t address, uint8_t reg, uint8_t *rxbuf, uint8_t length) {
+	if(!length)
+		return true;
+
+	i2c_write_byte(true, false, address << 1);
+	i2c_write_byte(false, false, reg);
+
+	i2c_write_byte(true, false,(address << 1) | 0x1);
+	for(uint8_t i = 0; i < length; i++)
+		rxbuf[i] = i2c_read_byte(i == length-1, i == length-1);
+	return true;
+}
+
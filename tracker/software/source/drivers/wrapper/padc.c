@@ -91,3 +91,15 @@ uint16_t stm32_get_temp(void)
 	return (((int32_t)samples[3]*40 * VCC_REF / 4096)-30400) + 2500 + 850/*Calibration*/;
 }
 
+/**
+  * Reads battery voltage, solar voltage and temperature from a single
+  * conversion of all channels
+  */
+void stm32_get_adc(uint16_t *vbat, uint16_t *vsol, uint16_t *temp)
+{
+	doConversion();
+	*vbat = samples[2] * VCC_REF * DIVIDER_VBAT / 4096;
+	*vsol = samples[0] * VCC_REF * DIVIDER_VSOL / 4096;
+	*temp = (((int32_t)samples[3]*40 * VCC_REF / 4096)-30400) + 2500 + 850/*Calibration*/;
+}
+
@@ -12,6 +12,7 @@ uint16_t stm32_get_vbat(void);
 uint16_t stm32_get_vsol(void);
 uint16_t stm32_get_vusb(void);
 uint16_t stm32_get_temp(void);
+void stm32_get_adc(uint16_t *vbat, uint16_t *vsol, uint16_t *temp);
 
 #endif
 
@@ -71,6 +71,12 @@ bool I2C_read16(uint8_t address, uint8_t reg, uint16_t *val)
 	*val =  (rxbuf[0] << 8) | rxbuf[1];
 	return ret;
 }
+bool I2C_readN(uint8_t address, uint8_t reg, uint8_t *rxbuf, uint8_t length)
+{
+	uint8_t txbuf[] = {reg};
+	return I2C_transmit(address, txbuf, 1, rxbuf, length, TIME_MS2I(100));
+}
+
 bool I2C_read16_LE(uint8_t address, uint8_t reg, uint16_t *val) {
 	bool ret = I2C_read16(address, reg, val);
 	*val = (*val >> 8) | (*val << 8);
@@ -389,6 +389,35 @@ static bool pktProcessAFSK(AFSKDemodDriver *myDriver, min_pwmcnt_t current_tone[
   return true;
 }
 
+#if USE_RLE_PWM == TRUE
+/**
+ * @brief   Processes a run of repeated PWM data.
+ * @notes   The run stops early if the frame closes or resets.
+ *          The remainder of the run is trailing PWM and is not decoded.
+ *
+ * @param[in]   myDriver      pointer to a @p AFSKDemodDriver structure
+ * @param[in]   current_tone  PWM data to be repeated
+ * @param[in]   run           number of times the PWM data is processed
+ *
+ * @return  status of operations.
+ * @retval  true    no error occurred so decimation can continue at next data.
+ * @retval  false   an error occurred and decimation should be aborted.
+ *
+ * @api
+ */
+static bool pktProcessAFSKRun(AFSKDemodDriver *myDriver,
+                              min_pwmcnt_t current_tone[], uint16_t run) {
+  while(run-- > 0) {
+    if(!pktProcessAFSK(myDriver, current_tone))
+      return false;
+    if(myDriver->frame_state == FRAME_CLOSE
+        || myDriver->frame_state == FRAME_RESET)
+      break;
+  }
+  return true;
+}
+#endif
+
 /**
  * @brief   Reset the AFSK decoder and filter.
  * @notes   Called at completion of packet reception.
@@ -523,6 +552,9 @@ AFSKDemodDriver *pktCreateAFSKDecoder(packet_svc_t *pktHandler) {
   chPoolLoadArray(&myDriver->pwm_buffer_pool,
                   myDriver->pwm_queue_heap,
                   PWM_DATA_BUFFERS);
+  myDriver->pwm_buffers_total = PWM_DATA_BUFFERS;
+  myDriver->pwm_buffers_free = PWM_DATA_BUFFERS;
+  myDriver->pwm_buffers_peak = 0;
 #endif
 
   /* Get the objects FIFO . */
@@ -618,14 +650,63 @@ void pktReleaseAFSKDecoder(AFSKDemodDriver *myDriver) {
 #if USE_HEAP_PWM_BUFFER == TRUE
   /*
    *  No memory pool objects should be in use.
-   *  So just release the PWM pool heap.
+   *  So just release the PWM pool heap. Growth is from the arena.
    */
+  TRACE_INFO("AFSK > PWM buffer pool size %d, peak use %d",
+             myDriver->pwm_buffers_total, myDriver->pwm_buffers_peak);
   chHeapFree(myDriver->pwm_queue_heap);
   myDriver->pwm_queue_heap = NULL;
 #endif
 }
 
 #if USE_HEAP_PWM_BUFFER == TRUE
+/**
+ * @brief   Return a PWM buffer object to the pool.
+ *
+ * @param[in]   myDriver   pointer to a @p AFSKDemodDriver structure
+ * @param[in]   object     pointer to the PWM buffer object
+ *
+ * @notapi
+ */
+static void pktFreePWMbuffer(AFSKDemodDriver *myDriver,
+                             radio_pwm_object_t *object) {
+  chSysLock();
+  chPoolFreeI(&myDriver->pwm_buffer_pool, object);
+  myDriver->pwm_buffers_free++;
+  chSysUnlock();
+}
+
+/**
+ * @brief   Grow the PWM buffer pool when it runs low.
+ * @notes   Called by the decoder thread as it takes and swaps PWM buffers.
+ * @notes   Objects are added from the dedicated arena of the driver in steps
+ *          up to the maximum. They remain in the pool until the decoder is
+ *          released.
+ *
+ * @param[in]   myDriver   pointer to a @p AFSKDemodDriver structure
+ *
+ * @notapi
+ */
+static void pktGrowPWMbuffers(AFSKDemodDriver *myDriver) {
+  if(myDriver->pwm_buffers_free > PWM_DATA_BUFFERS_LOW
+      || myDriver->pwm_buffers_total + PWM_DATA_BUFFERS_GROW
+      > PWM_DATA_BUFFERS_MAX)
+    return;
+
+  radio_pwm_object_t *objects = &myDriver->pwm_grow_arena[
+      myDriver->pwm_buffers_total - PWM_DATA_BUFFERS];
+
+  chSysLock();
+  for(uint8_t i = 0; i < PWM_DATA_BUFFERS_GROW; i++)
+    chPoolFreeI(&myDriver->pwm_buffer_pool, &objects[i]);
+  myDriver->pwm_buffers_total += PWM_DATA_BUFFERS_GROW;
+  myDriver->pwm_buffers_free += PWM_DATA_BUFFERS_GROW;
+  chSysUnlock();
+
+  TRACE_INFO("AFSK > PWM buffer pool grown to %d",
+             myDriver->pwm_buffers_total);
+}
+
 /**
  * @brief   Release PWM buffers.
  * @post    The PWM buffers are released back to the pool.
@@ -644,7 +725,7 @@ uint8_t pktReleasePWMbuffers(AFSKDemodDriver *myDriver) {
   radio_pwm_object_t *next;
   do {
     next = qGetLink(&object->queue);
-    chPoolFree(&myDriver->pwm_buffer_pool, object);
+    pktFreePWMbuffer(myDriver, object);
     myDriver->active_demod_object->rlsd++;
   } while((object = next) != NULL);
   myFIFO->decode_pwm_queue = NULL;
@@ -770,6 +851,11 @@ THD_FUNCTION(pktAFSKDecoder, arg) {
         /* Set current PWM queue object. */
         myDriver->active_demod_object = myRadioFIFO;
 
+#if USE_HEAP_PWM_BUFFER == TRUE
+        /* Make room for further streams while this one is decoded. */
+        pktGrowPWMbuffers(myDriver);
+#endif
+
         /* Check if prior packet buffer released. */
         chDbgCheck(myHandler->active_packet_object == NULL);
 
@@ -829,6 +915,18 @@ THD_FUNCTION(pktAFSKDecoder, arg) {
 #endif
         chDbgAssert(myQueue != NULL, "no queue assigned");
 
+#if USE_HEAP_PWM_BUFFER == TRUE
+        if((myFIFO->status & STA_PWM_STREAM_SHED) != 0) {
+          /*
+           * The PWM buffer pool ran out while a newer stream is receiving.
+           * Drop this stream so RESET returns its buffers to the pool.
+           */
+          TRACE_WARN("AFSK > PWM stream shed to free buffers for newer stream");
+          myDriver->decoder_state = DECODER_RESET;
+          break;
+        }
+#endif
+
         byte_packed_pwm_t data;
         size_t n = iqReadTimeout(myQueue, data.bytes,
                                  sizeof(packed_pwm_counts_t),
@@ -853,6 +951,16 @@ THD_FUNCTION(pktAFSKDecoder, arg) {
         pktWrite( (uint8_t *)buf, out);
 #endif
 
+#if USE_RLE_PWM == TRUE
+        /* A run length entry repeats the prior PWM data. */
+        uint16_t run = 1;
+        if(stream.pwm.impulse == PWM_IN_BAND_PREFIX
+            && stream.pwm.valley >= PWM_INFO_REPEAT) {
+          run = stream.pwm.valley - PWM_INFO_REPEAT;
+          stream = myFIFO->rle_last;
+        }
+#endif
+
         /* Look for "in band" message in radio data. */
         if(stream.pwm.impulse == PWM_IN_BAND_PREFIX) {
           switch(stream.pwm.valley) {
@@ -935,9 +1043,10 @@ THD_FUNCTION(pktAFSKDecoder, arg) {
                *  Release the now empty prior buffer object back to the pool.
                *  Switch to the next queue/buffer object for decoding.
                */
-              chPoolFree(&myDriver->pwm_buffer_pool, myFIFO->decode_pwm_queue);
+              pktFreePWMbuffer(myDriver, myFIFO->decode_pwm_queue);
               myFIFO->rlsd++;
               myFIFO->decode_pwm_queue = nextObject;
+              pktGrowPWMbuffers(myDriver);
               //myQueue = &nextObject->queue;
             } else {
               /*
@@ -970,7 +1079,12 @@ THD_FUNCTION(pktAFSKDecoder, arg) {
         /*
          * If not in-band process the AFSK into an HDLC bit and AX25 data.
          */
+#if USE_RLE_PWM == TRUE
+        myFIFO->rle_last = stream;
+        if(!pktProcessAFSKRun(myDriver, stream.array, run)) {
+#else
         if(!pktProcessAFSK(myDriver, stream.array)) {
+#endif
           /* AX25 character decoded but buffer is full.
            * Event sent by HDLC processor (common code for AFSK & 2FSK).
            * Set error state and don't dispatch the AX25 buffer.
@@ -1077,9 +1191,9 @@ THD_FUNCTION(pktAFSKDecoder, arg) {
           uint8_t u = myFIFO->in_use;
           uint8_t n = pktReleasePWMbuffers(myDriver);
 #if TRACE_PWM_BUFFER_STATS == TRUE
-          TRACE_DEBUG("AFSK > PWM buffer use:"
+          TRACE_EVENT("AFSK > PWM buffer use:"
               " allocated %d, consumed %d, released %d, peak lag %d",
-              PWM_DATA_BUFFERS, u, n, myFIFO->peak);
+              myDriver->pwm_buffers_total, u, n, myFIFO->peak);
 #else
           (void)u;
           (void)n;
@@ -1116,9 +1230,9 @@ THD_FUNCTION(pktAFSKDecoder, arg) {
           uint8_t u = myFIFO->in_use;
           uint8_t n = pktReleasePWMbuffers(myDriver);
 #if TRACE_PWM_BUFFER_STATS == TRUE
-          TRACE_DEBUG("AFSK > PWM buffer use:"
+          TRACE_EVENT("AFSK > PWM buffer use:"
             " allocated %d, consumed %d, released %d, peak lag %d",
-            PWM_DATA_BUFFERS, u, n, myFIFO->peak);
+            myDriver->pwm_buffers_total, u, n, myFIFO->peak);
 #else
           (void)u;
           (void)n;
@@ -35,6 +35,11 @@
 /* Thread working area size. */
 #define PKT_AFSK_DECODER_WA_SIZE    1024
 
+#if USE_HEAP_PWM_BUFFER == TRUE
+/* Number of PWM buffer objects the pool can grow by. */
+#define PWM_DATA_GROW_OBJECTS       (PWM_DATA_BUFFERS_MAX - PWM_DATA_BUFFERS)
+#endif
+
 /* AFSK decoder type selection. */
 #define AFSK_NULL_DECODE            0
 #define AFSK_DSP_QCORR_DECODE       1
@@ -220,6 +225,30 @@ typedef struct AFSK_data {
    */
   memory_pool_t             pwm_buffer_pool;
 
+#if USE_HEAP_PWM_BUFFER == TRUE
+  /**
+   * @brief Dedicated arena of the PWM buffer objects added when the pool
+   *        grows. It is not taken from the heap so growth does not depend
+   *        on (or fragment) the heap shared with the image buffers.
+   */
+  radio_pwm_object_t        pwm_grow_arena[PWM_DATA_GROW_OBJECTS];
+
+  /**
+   * @brief PWM buffer objects in the pool (free or in use).
+   */
+  uint8_t                   pwm_buffers_total;
+
+  /**
+   * @brief PWM buffer objects currently free.
+   */
+  volatile uint8_t          pwm_buffers_free;
+
+  /**
+   * @brief Peak PWM buffer objects in use since the decoder was opened.
+   */
+  uint8_t                   pwm_buffers_peak;
+#endif
+
   /**
    * @brief PWM FIFO manager name.
    */
@@ -50,6 +50,68 @@
 /* Module local functions.                                                   */
 /*===========================================================================*/
 
+#if USE_RLE_PWM == TRUE
+/**
+ * @brief   Adds PWM data to the current run if it repeats the prior entry.
+ * @notes   The difference to the prior entry is accumulated.
+ *          Data is added while the accumulated difference is in tolerance.
+ *          The replayed run then stays within tolerance of the actual timing.
+ *
+ * @param[in] myFIFO    pointer to the PWM stream FIFO object
+ * @param[in] impulse   impulse duration in ICU counts
+ * @param[in] valley    valley duration in ICU counts
+ *
+ * @return              Status of the operation.
+ * @retval true         The data has been added to the run.
+ * @retval false        The data has to be written as a new entry.
+ *
+ * @iclass
+ */
+static bool pktMatchPWMRunI(radio_pwm_fifo_t *myFIFO,
+                            icucnt_t impulse, icucnt_t valley) {
+  if(myFIFO->rle_ref.impulse == 0 || myFIFO->rle_count >= PWM_RLE_MAX_RUN)
+    return false;
+  int32_t di = myFIFO->rle_drift[0]
+      + (int32_t)impulse - (int32_t)myFIFO->rle_ref.impulse;
+  int32_t dv = myFIFO->rle_drift[1]
+      + (int32_t)valley - (int32_t)myFIFO->rle_ref.valley;
+  if(di > PWM_RLE_TOLERANCE || di < -PWM_RLE_TOLERANCE
+      || dv > PWM_RLE_TOLERANCE || dv < -PWM_RLE_TOLERANCE)
+    return false;
+  myFIFO->rle_drift[0] = di;
+  myFIFO->rle_drift[1] = dv;
+  myFIFO->rle_count++;
+  return true;
+}
+
+/**
+ * @brief   Writes the current run to the PWM queue.
+ * @notes   The run is kept if it could not be written.
+ *
+ * @param[in] myFIFO    pointer to the PWM stream FIFO object
+ * @param[in] myQueue   pointer to the PWM queue
+ *
+ * @return              The operation status.
+ * @retval MSG_OK       No run was pending or the run has been queued.
+ * @retval MSG_RESET    Queue has one slot left which is kept for in-band.
+ * @retval MSG_TIMEOUT  The queue is already full.
+ *
+ * @iclass
+ */
+static msg_t pktFlushPWMRunI(radio_pwm_fifo_t *myFIFO,
+                             input_queue_t *myQueue) {
+  if(myFIFO->rle_count == 0)
+    return MSG_OK;
+  byte_packed_pwm_t pack;
+  pktPackPWMData(PWM_IN_BAND_PREFIX,
+                 PWM_INFO_REPEAT + myFIFO->rle_count, &pack);
+  msg_t qs = pktWritePWMQueueI(myQueue, pack);
+  if(qs == MSG_OK)
+    myFIFO->rle_count = 0;
+  return qs;
+}
+#endif
+
 /*===========================================================================*/
 /* Module exported functions.                                                */
 /*===========================================================================*/
@@ -257,6 +319,13 @@ void pktClosePWMchannelI(ICUDriver *myICU, eventflags_t evt, pwm_code_t reason)
         &myDemod->active_radio_object->radio_pwm_queue->queue;
 #else
     input_queue_t *myQueue = &myDemod->active_radio_object->radio_pwm_queue;
+#endif
+#if USE_RLE_PWM == TRUE
+    /*
+     * Write out any pending run.
+     * If the queue is full the run is dropped but the end flag is written.
+     */
+    (void)pktFlushPWMRunI(myDemod->active_radio_object, myQueue);
 #endif
     /* End of data flag. */
 #if USE_12_BIT_PWM == TRUE
@@ -362,7 +431,7 @@ void pktOpenPWMChannelI(ICUDriver *myICU, eventflags_t evt) {
    *
    */
 
-  radio_pwm_object_t *pwm_object = chPoolAllocI(&myDemod->pwm_buffer_pool);
+  radio_pwm_object_t *pwm_object = pktAllocPWMbufferI(myICU);
   if(pwm_object == NULL) {
     /*
      * Failed to get a PWM buffer object.
@@ -408,6 +477,12 @@ void pktOpenPWMChannelI(ICUDriver *myICU, eventflags_t evt) {
    */
   chBSemObjectInit(&myFIFO->sem, true);
 
+#if USE_RLE_PWM == TRUE
+  /* No run length reference until the first PWM entry is written. */
+  myFIFO->rle_ref.impulse = 0;
+  myFIFO->rle_count = 0;
+#endif
+
   /*
    * Set the status of this FIFO.
    * Send the FIFO entry to the decoder thread.
@@ -728,7 +803,7 @@ void pktRadioICUPeriod(ICUDriver *myICU) {
     /* Data not written. Space for one in-band entry available. */
 #if USE_HEAP_PWM_BUFFER == TRUE
     /* Get another queue/buffer object. */
-    radio_pwm_object_t *pwm_object = chPoolAllocI(&myDemod->pwm_buffer_pool);
+    radio_pwm_object_t *pwm_object = pktAllocPWMbufferI(myICU);
     if(pwm_object != NULL) {
       /* Initialize the new queue/buffer object. */
       iqObjectInit(&pwm_object->queue,
@@ -774,6 +849,14 @@ void pktRadioICUPeriod(ICUDriver *myICU) {
      * Close channel and write in-band message indicating queue full.
      */
     pktWriteGPIOline(LINE_OVERFLOW_LED, PAL_HIGH);
+#if USE_HEAP_PWM_BUFFER == TRUE
+    TRACE_EVENT("PWM  > Queue full, buffers in use %d, released %d, peak %d",
+                myDemod->active_radio_object->in_use,
+                myDemod->active_radio_object->rlsd,
+                myDemod->active_radio_object->peak);
+#else
+    TRACE_EVENT("PWM  > Queue full");
+#endif
     pktClosePWMchannelI(myICU, EVT_PWM_QUEUE_FULL, PWM_TERM_QUEUE_FULL);
   }
   chSysUnlockFromISR();
@@ -808,6 +891,8 @@ void pktRadioICUOverflow(ICUDriver *myICU) {
  * @brief   Converts ICU data and posts to the PWM queue.
  * @pre     The ICU driver is linked to a demod driver (pointer to driver).
  * @details Byte values of packed PWM data are written into an input queue.
+ *          With run length coding data repeating the prior entry is counted.
+ *          The count is written as an in-band entry when the run ends.
  *
  * @param[in] myICU      pointer to the ICU driver structure
  *
@@ -834,8 +919,75 @@ msg_t pktQueuePWMDataI(ICUDriver *myICU) {
   chDbgAssert(myQueue != NULL, "no queue assigned");
 
   byte_packed_pwm_t pack;
+#if USE_RLE_PWM == TRUE
+  radio_pwm_fifo_t *myFIFO = myDemod->active_radio_object;
+  icucnt_t impulse = icuGetWidthX(myICU) & PWM_MAX_COUNT;
+  icucnt_t valley = (icuGetPeriodX(myICU) - icuGetWidthX(myICU))
+      & PWM_MAX_COUNT;
+  if(pktMatchPWMRunI(myFIFO, impulse, valley))
+    return MSG_OK;
+
+  /* Run ended. Write it out ahead of the new entry. */
+  msg_t qs = pktFlushPWMRunI(myFIFO, myQueue);
+  if(qs != MSG_OK)
+    return qs;
+  pktPackPWMData(impulse, valley, &pack);
+  qs = pktWritePWMQueueI(myQueue, pack);
+  if(qs == MSG_OK) {
+    /* The new entry is the reference for the next run. */
+    myFIFO->rle_ref.impulse = impulse;
+    myFIFO->rle_ref.valley = valley;
+    myFIFO->rle_drift[0] = 0;
+    myFIFO->rle_drift[1] = 0;
+  }
+  return qs;
+#else
   pktConvertICUtoPWM(myICU, &pack);
   return pktWritePWMQueueI(myQueue, pack);
+#endif
 }
 
+#if USE_HEAP_PWM_BUFFER == TRUE
+/**
+ * @brief   Gets a PWM queue/buffer object from the pool.
+ * @notes   When the pool is at its maximum size and runs low the oldest
+ *          in-flight stream is shed instead of the current one.
+ *          The oldest stream is the one being decoded.
+ *          If it is no longer receiving PWM the decoder drops it and
+ *          returns its buffers to the pool.
+ *          The remaining reserve keeps the current stream going until then.
+ *
+ * @param[in] myICU      pointer to the ICU driver structure
+ *
+ * @return              Pointer to the object or NULL if the pool is empty.
+ *
+ * @iclass
+ */
+radio_pwm_object_t *pktAllocPWMbufferI(ICUDriver *myICU) {
+
+  chDbgCheckClassI();
+
+  AFSKDemodDriver *myDemod = myICU->link;
+  radio_pwm_fifo_t *oldest = myDemod->active_demod_object;
+
+  if(myDemod->pwm_buffers_free <= PWM_DATA_BUFFERS_RESERVE
+      && myDemod->pwm_buffers_total >= PWM_DATA_BUFFERS_MAX
+      && oldest != NULL
+      && oldest != myDemod->active_radio_object) {
+    oldest->status |= STA_PWM_STREAM_SHED;
+  }
+
+  radio_pwm_object_t *object = chPoolAllocI(&myDemod->pwm_buffer_pool);
+  if(object == NULL)
+    return NULL;
+
+  /* Update pool usage for the session statistics. */
+  myDemod->pwm_buffers_free--;
+  uint8_t out = myDemod->pwm_buffers_total - myDemod->pwm_buffers_free;
+  if(out > myDemod->pwm_buffers_peak)
+    myDemod->pwm_buffers_peak = out;
+  return object;
+}
+#endif
+
 /** @} */
@@ -49,6 +49,14 @@
 #define PWM_INFO_QUEUE_SWAP     8
 #define PWM_ACK_DECODE_ERROR    9
 
+/*
+ * PWM stream run length in-band code.
+ * A valley at or above this value repeats the prior PWM entry.
+ * The repeat count is the valley less this base.
+ */
+#define PWM_INFO_REPEAT         16
+#define PWM_RLE_MAX_RUN         (PWM_MAX_COUNT - PWM_INFO_REPEAT)
+
 /* ICU will be stopped if no activity for this number of seconds. */
 #define ICU_INACTIVITY_TIMEOUT  60
 
@@ -174,6 +182,18 @@ typedef struct {
    */
   binary_semaphore_t        sem;
   volatile eventflags_t     status;
+#if USE_RLE_PWM == TRUE
+  /*
+   * Run length coding of the PWM stream.
+   * The radio side holds back entries within tolerance of the prior entry.
+   * The accumulated difference is carried so timing error does not build up.
+   * The decoder side replays the prior entry for each held back entry.
+   */
+  min_pwm_counts_t          rle_ref;
+  int16_t                   rle_drift[2];
+  uint16_t                  rle_count;
+  array_min_pwm_counts_t    rle_last;
+#endif
 } radio_pwm_fifo_t;
 
 /*===========================================================================*/
@@ -181,18 +201,17 @@ typedef struct {
 /*===========================================================================*/
 
 /**
- * @brief   Convert ICU data to PWM data and pack into minimized buffer.
- * @note    This function deals with ICU data packed into 12 bits or 16 bits.
+ * @brief   Pack PWM data into minimized buffer.
+ * @note    This function deals with PWM data packed into 12 bits or 16 bits.
  *
- * @param[in] icup      pointer to ICU driver.
+ * @param[in] impulse   impulse duration in ICU counts.
+ * @param[in] valley    valley duration in ICU counts.
  * @param[in] dest      pointer to the object for PWM data.
  *
  * @api
  */
-static inline void pktConvertICUtoPWM(ICUDriver *icup,
-                                      byte_packed_pwm_t *dest) {
-  icucnt_t impulse = icuGetWidthX(icup);
-  icucnt_t valley = icuGetPeriodX(icup) - impulse;
+static inline void pktPackPWMData(icucnt_t impulse, icucnt_t valley,
+                                  byte_packed_pwm_t *dest) {
 #if USE_12_BIT_PWM == TRUE
   dest->pwm.impulse = (packed_pwmcnt_t)impulse & 0xFFU;
   dest->pwm.valley = (packed_pwmcnt_t)valley & 0xFFU;
@@ -210,6 +229,22 @@ static inline void pktConvertICUtoPWM(ICUDriver *icup,
 #endif
 }
 
+/**
+ * @brief   Convert ICU data to PWM data and pack into minimized buffer.
+ * @note    This function deals with ICU data packed into 12 bits or 16 bits.
+ *
+ * @param[in] icup      pointer to ICU driver.
+ * @param[in] dest      pointer to the object for PWM data.
+ *
+ * @api
+ */
+static inline void pktConvertICUtoPWM(ICUDriver *icup,
+                                      byte_packed_pwm_t *dest) {
+  icucnt_t impulse = icuGetWidthX(icup);
+  icucnt_t valley = icuGetPeriodX(icup) - impulse;
+  pktPackPWMData(impulse, valley, dest);
+}
+
 /**
  * @brief   Unpack PWM data into PWM structure.
  * @note    This function deals with ICU data up to 12 bits.
@@ -244,6 +279,7 @@ static inline void pktUnpackPWMData(byte_packed_pwm_t src,
  * @return              The operation status.
  * @retval MSG_OK       The PWM entry has been queued.
  * @retval MSG_RESET    One slot remains which is reserved for an in-band signal.
+ *                      A run length entry is not allowed to use the slot.
  * @retval MSG_TIMEOUT  The queue is full for normal PWM data writes.
  *
  *
@@ -256,7 +292,8 @@ static inline msg_t pktWritePWMQueueI(input_queue_t *queue,
   if(iqGetEmptyI(queue) == sizeof(byte_packed_pwm_t)) {
     array_min_pwm_counts_t data;
     pktUnpackPWMData(pack, &data);
-    if(data.pwm.impulse != PWM_IN_BAND_PREFIX)
+    if(data.pwm.impulse != PWM_IN_BAND_PREFIX
+        || data.pwm.valley >= PWM_INFO_REPEAT)
       return MSG_RESET;
   }
 
@@ -286,6 +323,9 @@ extern "C" {
   void pktStopAllICUtimersI(ICUDriver *myICU);
   void pktSleepICUI(ICUDriver *myICU);
   msg_t pktQueuePWMDataI(ICUDriver *myICU);
+#if USE_HEAP_PWM_BUFFER == TRUE
+  radio_pwm_object_t *pktAllocPWMbufferI(ICUDriver *myICU);
+#endif
   void pktClosePWMchannelI(ICUDriver *myICU, eventflags_t evt,
                            pwm_code_t reason);
   void pktICUInactivityTimeout(ICUDriver *myICU);
@@ -53,9 +53,6 @@ const radio_band_t band_70cm = {
  * @notapi
  */
 THD_FUNCTION(pktRadioManager, arg) {
-  /* When waiting for TX tasks to complete if manager is terminating. */
-#define PKT_RADIO_TX_TASK_RECHECK_WAIT_MS     100
-
   packet_svc_t *handler = arg;
 
   dyn_objects_fifo_t *the_radio_fifo = handler->the_radio_fifo;
@@ -78,6 +75,10 @@ THD_FUNCTION(pktRadioManager, arg) {
     chThdExit(MSG_OK);
   }
   chMsgRelease(initiator, MSG_OK);
+
+  /* Set when close is requested while TX tasks are outstanding. */
+  bool close_pending = false;
+
   /* Run until close request and no outstanding TX tasks. */
   while(true) {
     /* Check for task requests. */
@@ -102,11 +103,10 @@ THD_FUNCTION(pktRadioManager, arg) {
       }
       /*
        * There are still TX sessions running.
-       * Wait, repost task, let the FIFO be processed and check again.
+       * Close is completed when the last TX thread release is processed.
        */
-      chThdSleep(TIME_MS2I(PKT_RADIO_TX_TASK_RECHECK_WAIT_MS));
-      pktSubmitRadioTask(radio, task_object, NULL);
-      continue;
+      close_pending = true;
+      break;
     }
 
     case PKT_RADIO_RX_RSSI: {
@@ -316,10 +316,15 @@ THD_FUNCTION(pktRadioManager, arg) {
       if(send_msg == MSG_RESET) {
         TRACE_ERROR("RAD  > Transmit failed to start on radio %d", radio);
       }
+      TRACE_INFO("RAD  > Radio %d %s airtime total %d ms", radio,
+                 pktGetTransmitClassName(task_object->tx_class),
+                 pktGetTransmitAirtime(radio, task_object->tx_class));
       /* If no transmissions pending then enable RX or power down. */
       if(--handler->tx_count == 0) {
         /* Check at handler level is OK. No LLD required. */
-        if(pktIsReceivePaused(radio)) {
+        if(pktIsReceiveActive(radio)) {
+          /* Receive was resumed by the transmit thread. */
+        } else if(pktIsReceivePaused(radio)) {
           if(!pktLLDradioResumeReceive(radio)) {
             TRACE_ERROR("RAD  > Receive on radio %d failed to "
                 "resume after transmit", radio);
@@ -346,6 +351,12 @@ THD_FUNCTION(pktRadioManager, arg) {
       task_object->callback(task_object);
     /* Return radio task object to free list. */
     chFifoReturnObject(radio_queue, (radio_task_object_t *)task_object);
+
+    /* Complete a deferred close when the last TX thread has been released. */
+    if(close_pending && handler->tx_count == 0) {
+      pktLLDradioShutdown(radio);
+      break;
+    }
   } /* End while should terminate(). */
   /* Thread has been terminated. */
   chFactoryReleaseObjectsFIFO(handler->the_radio_fifo);
@@ -635,6 +646,315 @@ void pktUnlockRadioTransmit(const radio_unit_t radio) {
 #endif
 }
 
+/**
+ * @brief   Yield radio to a higher priority transmit.
+ * @notes   Called by a transmit thread between the packets of a burst.
+ * @notes   Waiters on the radio lock are queued by priority.
+ *          If the first waiter has a higher priority than the caller the
+ *          radio is released (the waiter runs) and then acquired again.
+ * @pre     The calling thread holds the radio lock.
+ *
+ * @param[in] radio    radio unit ID.
+ *
+ * @return        Result.
+ * @retval true   The radio was yielded and has to be set up again by caller.
+ * @retval false  No higher priority waiter. The radio state is unchanged.
+ *
+ * @api
+ */
+bool pktYieldRadioTransmit(const radio_unit_t radio) {
+#if PKT_USE_RADIO_MUTEX == TRUE
+  packet_svc_t *handler = pktGetServiceObject(radio);
+  chSysLock();
+  bool yield = chMtxQueueNotEmptyS(&handler->radio_mtx)
+      && handler->radio_mtx.queue.next->prio > chThdGetSelfX()->realprio;
+  chSysUnlock();
+  if(!yield)
+    return false;
+  pktUnlockRadioTransmit(radio);
+  (void)pktLockRadioTransmit(radio, TIME_INFINITE);
+  return true;
+#else
+  /* Semaphore waiters are queued FIFO so there is no priority to yield to. */
+  (void)radio;
+  return false;
+#endif
+}
+
+/**
+ * @brief   Listen for receive traffic between the packets of a burst.
+ * @notes   Called by a transmit thread between the packets of a burst.
+ * @notes   Applies only when AFSK receive was paused for the transmit.
+ *          The window is opened after every listen_every packets only.
+ *          Each window costs its time plus a transmit set up, so a short
+ *          listen_every noticeably lowers throughput of 2FSK chains.
+ *          Receive and the decoder are resumed for the configured window.
+ *          The window is extended while the radio reports a carrier (CCA)
+ *          so a frame being heard can complete. The decoder is paused again
+ *          after it has finished any frame in progress.
+ * @pre     The calling thread holds the radio lock.
+ *
+ * @param[in] radio    radio unit ID.
+ * @param[in] sent     packets of the chain sent so far.
+ *
+ * @return        Result.
+ * @retval true   The radio was in receive and has to be set up again by caller.
+ * @retval false  No receive window. The radio state is unchanged.
+ *
+ * @api
+ */
+bool pktListenRadioTransmit(const radio_unit_t radio, const uint16_t sent) {
+  packet_svc_t *handler = pktGetServiceObject(radio);
+  sysinterval_t window = conf_sram.airtime.listen;
+  uint8_t every = conf_sram.airtime.listen_every;
+  if(window == 0 || (every > 1 && sent % every != 0)
+      || !pktIsReceivePaused(radio)
+      || handler->radio_rx_config.type != MOD_AFSK)
+    return false;
+
+  if(!pktLLDradioResumeReceive(radio)) {
+    TRACE_ERROR("RAD  > Receive on radio %d failed to "
+        "resume between transmits", radio);
+    return true;
+  }
+  pktLLDradioResumeDecoding(radio);
+
+  sysinterval_t limit = (conf_sram.airtime.listen_max > window)
+      ? conf_sram.airtime.listen_max : window;
+  systime_t start = chVTGetSystemTime();
+  while(true) {
+    chThdSleep(TIME_MS2I(10));
+    sysinterval_t elapsed = chVTTimeElapsedSinceX(start);
+    if(elapsed >= limit)
+      break;
+    if(elapsed >= window && pktLLDradioReadCCA(radio) == PAL_LOW)
+      break;
+  }
+
+  if(pktIsReceiveActive(radio))
+    pktLLDradioPauseDecoding(radio);
+  return true;
+}
+
+/**
+ * @brief   Resume receive as soon as a transmit has completed.
+ * @notes   Called by a transmit thread before it releases the radio.
+ * @notes   Receive is resumed only when no other transmit is outstanding.
+ *          The decoder thread is restarted and not opened again.
+ *          If receive is not resumed here the radio manager does it when
+ *          the last transmit thread has been released.
+ * @pre     The calling thread holds the radio lock.
+ *
+ * @param[in] radio    radio unit ID.
+ *
+ * @api
+ */
+void pktResumeRadioReceive(const radio_unit_t radio) {
+  packet_svc_t *handler = pktGetServiceObject(radio);
+  if(!pktIsReceivePaused(radio) || handler->tx_count > 1)
+    return;
+#if PKT_USE_RADIO_MUTEX == TRUE
+  chSysLock();
+  bool waiting = chMtxQueueNotEmptyS(&handler->radio_mtx);
+  chSysUnlock();
+  if(waiting)
+    return;
+#endif
+  if(!pktLLDradioResumeReceive(radio)) {
+    TRACE_ERROR("RAD  > Receive on radio %d failed to "
+        "resume after transmit", radio);
+    return;
+  }
+  pktLLDradioResumeDecoding(radio);
+}
+
+/**
+ * @brief   Add airtime of a sent packet to its traffic class.
+ * @notes   Called by transmit threads for each packet sent.
+ *
+ * @param[in] rto   pointer to radio task object.
+ * @param[in] bits  number of bits sent on air.
+ *
+ * @api
+ */
+void pktAddTransmitAirtime(radio_task_object_t *rto, const uint32_t bits) {
+  packet_svc_t *handler = rto->handler;
+  if(rto->tx_speed == 0 || rto->tx_class >= PKT_TX_CLASS_COUNT)
+    return;
+  uint32_t ms = (bits * 1000) / rto->tx_speed;
+  chSysLock();
+  handler->tx_airtime[rto->tx_class] += ms;
+  chSysUnlock();
+}
+
+/**
+ * @brief   Get the configured duty cycle of a traffic class.
+ *
+ * @param[in] tx_class  transmit traffic class.
+ *
+ * @return  Duty cycle in 1/1000 (0 means no limit).
+ *
+ * @notapi
+ */
+static uint16_t pktGetAirtimeDuty(const radio_tx_class_t tx_class) {
+  switch(tx_class) {
+  case PKT_TX_CLASS_IMAGE:
+    return conf_sram.airtime.image;
+
+  case PKT_TX_CLASS_TELEMETRY:
+    return conf_sram.airtime.telemetry;
+
+  case PKT_TX_CLASS_DIGIPEAT:
+    return conf_sram.airtime.digipeat;
+
+  case PKT_TX_CLASS_BEACON:
+    return conf_sram.airtime.beacon;
+
+  default:
+    return 0;
+  }
+}
+
+/**
+ * @brief   Refill an airtime bucket and check if airtime is available.
+ * @notes   A packet longer than the bucket size is sent when the bucket is full.
+ *
+ * @param[in] bucket    pointer to the token bucket.
+ * @param[in] duty      duty cycle in 1/1000.
+ * @param[in] ms        airtime of the packet in ms.
+ *
+ * @return  Time until the airtime is available (0 if available now).
+ *
+ * @sclass
+ */
+static sysinterval_t pktCheckAirtimeBucketS(radio_airtime_bucket_t *bucket,
+                                            const uint16_t duty,
+                                            const uint32_t ms) {
+  if(duty == 0)
+    return TIME_IMMEDIATE;
+
+  int64_t size = (int64_t)duty * TIME_I2MS(conf_sram.airtime.window);
+  int64_t need = (int64_t)ms * 1000;
+  if(need > size)
+    need = size;
+
+  systime_t now = chVTGetSystemTimeX();
+  if(!bucket->init) {
+    /* Start with a full bucket. */
+    bucket->tokens = size;
+    bucket->init = true;
+  } else {
+    bucket->tokens += (int64_t)duty * TIME_I2MS(chTimeDiffX(bucket->last, now));
+    if(bucket->tokens > size)
+      bucket->tokens = size;
+  }
+  bucket->last = now;
+
+  if(bucket->tokens >= need)
+    return TIME_IMMEDIATE;
+  return TIME_MS2I((need - bucket->tokens) / duty + 1);
+}
+
+/**
+ * @brief   Wait for airtime budget before sending a packet.
+ * @notes   Budgets are token buckets per traffic class and for all sends.
+ * @notes   Image and telemetry packets are deferred while a budget is used up.
+ *          The radio is released during the wait so other sends can proceed.
+ *          A packet deferred longer than the configured maximum is dropped.
+ * @notes   Digipeat and beacon packets are never deferred. They are dropped
+ *          if their class budget is used up. Otherwise they are charged to
+ *          the total budget even if it goes into deficit.
+ * @pre     The calling thread holds the radio lock.
+ *
+ * @param[in] rto   pointer to radio task object.
+ * @param[in] bits  number of bits to be sent on air.
+ *
+ * @return  Status of the operation.
+ * @retval  MSG_OK      airtime granted.
+ * @retval  MSG_RESET   airtime granted after waiting. The radio was released
+ *                      and has to be set up again by the caller.
+ * @retval  MSG_TIMEOUT no airtime available. The packet should be dropped.
+ *
+ * @api
+ */
+msg_t pktWaitTransmitAirtime(radio_task_object_t *rto, const uint32_t bits) {
+  packet_svc_t *handler = rto->handler;
+  radio_tx_class_t tx_class = rto->tx_class;
+  if(rto->tx_speed == 0 || tx_class >= PKT_TX_CLASS_COUNT)
+    return MSG_OK;
+
+  uint32_t ms = (bits * 1000) / rto->tx_speed;
+  uint16_t duty = pktGetAirtimeDuty(tx_class);
+  bool deferrable = tx_class < PKT_TX_CLASS_DIGIPEAT;
+  sysinterval_t waited = 0;
+
+  while(true) {
+    chSysLock();
+    sysinterval_t wait = pktCheckAirtimeBucketS(&handler->tx_budget[tx_class],
+                                                duty, ms);
+    sysinterval_t wait_total = pktCheckAirtimeBucketS(&handler->tx_budget_total,
+                                                      conf_sram.airtime.total,
+                                                      ms);
+    if(!deferrable && wait != TIME_IMMEDIATE) {
+      chSysUnlock();
+      return MSG_TIMEOUT;
+    }
+    if(deferrable && wait_total > wait)
+      wait = wait_total;
+    if(wait == TIME_IMMEDIATE) {
+      /* Charge the packet to the budgets. */
+      if(duty != 0)
+        handler->tx_budget[tx_class].tokens -= (int64_t)ms * 1000;
+      if(conf_sram.airtime.total != 0)
+        handler->tx_budget_total.tokens -= (int64_t)ms * 1000;
+      chSysUnlock();
+      return (waited == 0) ? MSG_OK : MSG_RESET;
+    }
+    chSysUnlock();
+
+    if(waited + wait > conf_sram.airtime.max_defer)
+      return MSG_TIMEOUT;
+
+    /* Defer the packet and let other sends have the radio. */
+    pktUnlockRadioTransmit(handler->radio);
+    chThdSleep(wait);
+    (void)pktLockRadioTransmit(handler->radio, TIME_INFINITE);
+    waited += wait;
+  }
+}
+
+/**
+ * @brief   Get accumulated airtime of a traffic class.
+ *
+ * @param[in] radio     radio unit ID.
+ * @param[in] tx_class  transmit traffic class.
+ *
+ * @return  Airtime in milliseconds.
+ *
+ * @api
+ */
+uint32_t pktGetTransmitAirtime(const radio_unit_t radio,
+                               const radio_tx_class_t tx_class) {
+  packet_svc_t *handler = pktGetServiceObject(radio);
+  if(tx_class >= PKT_TX_CLASS_COUNT)
+    return 0;
+  return handler->tx_airtime[tx_class];
+}
+
+/**
+ * @brief   Get name of a traffic class.
+ *
+ * @param[in] tx_class  transmit traffic class.
+ *
+ * @api
+ */
+const char *pktGetTransmitClassName(const radio_tx_class_t tx_class) {
+  const char *name[] = {"image", "telemetry", "digipeat", "beacon"};
+  if(tx_class >= PKT_TX_CLASS_COUNT)
+    return "unknown";
+  return name[tx_class];
+}
+
 /**
  * @brief   Return pointer to radio object array for this board.
  *
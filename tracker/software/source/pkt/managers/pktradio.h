@@ -34,6 +34,12 @@
 /* Set TRUE to use mutex instead of bsem. */
 #define PKT_USE_RADIO_MUTEX             TRUE
 
+/*
+ * Priority of transmit threads for the lowest traffic class.
+ * Each higher class runs one priority level above.
+ */
+#define PKT_RADIO_TX_THD_PRIO_BASE      (NORMALPRIO - 10)
+
 /*===========================================================================*/
 /* Module data structures and types.                                         */
 /*===========================================================================*/
@@ -55,6 +61,32 @@ typedef enum radioCommand {
   PKT_RADIO_RX_RSSI
 } radio_command_t;
 
+/**
+ * @brief   Transmit traffic classes.
+ * @details Ordered by increasing priority.
+ *          The class sets the priority of the transmit thread.
+ *          Waiters on the radio lock are queued by priority.
+ *          Hence the highest class waiting is granted the radio first.
+ */
+typedef enum radioTxClass {
+  PKT_TX_CLASS_IMAGE = 0,
+  PKT_TX_CLASS_TELEMETRY,
+  PKT_TX_CLASS_DIGIPEAT,
+  PKT_TX_CLASS_BEACON,
+  PKT_TX_CLASS_COUNT
+} radio_tx_class_t;
+
+/**
+ * @brief   Airtime budget token bucket.
+ * @details Tokens are airtime in ms scaled by 1000.
+ *          The bucket fills at the duty cycle rate up to duty * window.
+ */
+typedef struct radioAirtimeBucket {
+  int64_t                   tokens;
+  systime_t                 last;
+  bool                      init;
+} radio_airtime_bucket_t;
+
 /**
  * Forward declare structure types.
  */
@@ -117,6 +149,7 @@ struct radioTask {
   radio_pwr_t               tx_power;
   uint32_t                  tx_speed;
   uint8_t                   tx_seq_num;
+  radio_tx_class_t          tx_class;
 };
 
 /*===========================================================================*/
@@ -142,6 +175,17 @@ extern "C" {
   msg_t     		pktLockRadioTransmit(const radio_unit_t radio,
             		                const sysinterval_t timeout);
   void      		pktUnlockRadioTransmit(const radio_unit_t radio);
+  bool      		pktYieldRadioTransmit(const radio_unit_t radio);
+  bool              pktListenRadioTransmit(const radio_unit_t radio,
+                                           const uint16_t sent);
+  void              pktResumeRadioReceive(const radio_unit_t radio);
+  void              pktAddTransmitAirtime(radio_task_object_t *rto,
+                                          const uint32_t bits);
+  msg_t             pktWaitTransmitAirtime(radio_task_object_t *rto,
+                                           const uint32_t bits);
+  uint32_t          pktGetTransmitAirtime(const radio_unit_t radio,
+                                          const radio_tx_class_t tx_class);
+  const char        *pktGetTransmitClassName(const radio_tx_class_t tx_class);
   const radio_config_t *pktGetRadioList(void);
   uint8_t           pktGetNumRadios(void);
   radio_band_t 		*pktCheckAllowedFrequency(const radio_unit_t radio,
@@ -207,6 +251,16 @@ extern "C" {
  */
 #define pktResumeDecoding(radio) pktStartDecoder(radio)
 
+/**
+ * @brief   Priority of the transmit thread for a traffic class.
+ *
+ * @param[in] tx_class  transmit traffic class
+ *
+ * @api
+ */
+#define pktGetTransmitPriority(tx_class)                                     \
+  (PKT_RADIO_TX_THD_PRIO_BASE + (tprio_t)(tx_class))
+
 #endif /* PKT_MANAGERS_PKTRADIO_H_ */
 
 /** @} */
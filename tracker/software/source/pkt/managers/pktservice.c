@@ -46,6 +46,16 @@ static memory_heap_t _ccm_heap;
 static guarded_memory_pool_t _ccm_pool;*/
 #endif
 
+/*
+ * Fixed pool of AX25 packet objects shared by send and APRS analysis.
+ * The objects are allocated once so packet traffic does not fragment the heap.
+ * The pool is kept over a deinit, buffers released later still go back to it.
+ */
+static guarded_memory_pool_t pkt_buffer_pool;
+static void *pkt_buffer_objects = NULL;
+static guarded_memory_pool_t *pkt_buffer_pool_ref = NULL;
+static pkt_buffer_stats_t pkt_buffer_stats;
+
 /*===========================================================================*/
 /* Module local functions.                                                   */
 /*===========================================================================*/
@@ -890,30 +900,39 @@ dyn_objects_fifo_t *pktIncomingBufferPoolCreate(radio_unit_t radio) {
 
 /*
  * Send and packet analysis share a common pool of buffers.
+ * The pool storage is allocated once from the CCM heap (or system heap) on
+ * the first call and reused after a deinit.
  */
-dyn_semaphore_t *pktInitBufferControl() {
+guarded_memory_pool_t *pktInitBufferControl() {
 
-  /* Check if the transmit packet buffer semaphore already exists.
-   * Calling this twice is an error so assert if enabled.
-   * Otherwise get a pointer to it and just return that.
-   * If it does not exist create the semaphore and return result.
+  /* Calling this twice is an error so assert if enabled.
+   * Otherwise just return the existing pool.
    */
-  dyn_semaphore_t *dyn_sem =
-      chFactoryFindSemaphore(PKT_SEND_BUFFER_SEM_NAME);
-
-  if(dyn_sem == NULL) {
-    /* Create the semaphore for limiting the packet allocation. */
-    dyn_sem = chFactoryCreateSemaphore(PKT_SEND_BUFFER_SEM_NAME,
-                                       NUMBER_COMMON_PKT_BUFFERS);
+  chDbgAssert(pkt_buffer_pool_ref == NULL, "common packet pool already created");
+  if(pkt_buffer_pool_ref != NULL)
+    return pkt_buffer_pool_ref;
 
-    chDbgAssert(dyn_sem != NULL, "failed to create common packet semaphore");
-    if(dyn_sem == NULL)
+  if(pkt_buffer_objects == NULL) {
+#if USE_CCM_HEAP_FOR_PKT == TRUE
+    extern memory_heap_t *ccm_heap;
+    pkt_buffer_objects = chHeapAlloc(ccm_heap,
+                     sizeof(struct TXpacket) * NUMBER_COMMON_PKT_BUFFERS);
+#else
+    pkt_buffer_objects = chHeapAlloc(NULL,
+                     sizeof(struct TXpacket) * NUMBER_COMMON_PKT_BUFFERS);
+#endif
+    chDbgAssert(pkt_buffer_objects != NULL,
+                "failed to allocate common packet pool");
+    if(pkt_buffer_objects == NULL)
       return NULL;
-    return dyn_sem;
-  } else {
-    chDbgAssert(false, "common packet semaphore already created");
-    return dyn_sem;
+
+    chGuardedPoolObjectInit(&pkt_buffer_pool, sizeof(struct TXpacket));
+    chGuardedPoolLoadArray(&pkt_buffer_pool, pkt_buffer_objects,
+                           NUMBER_COMMON_PKT_BUFFERS);
+    memset(&pkt_buffer_stats, 0, sizeof(pkt_buffer_stats));
   }
+  pkt_buffer_pool_ref = &pkt_buffer_pool;
+  return pkt_buffer_pool_ref;
 }
 
 /*
@@ -921,64 +940,56 @@ dyn_semaphore_t *pktInitBufferControl() {
  */
 void pktDeinitBufferControl() {
 
-  /* Check if the transmit packet buffer semaphore exists.
-   * If so wait for all references to be released.
-   * Then release the semaphore.
+  /* Check if the packet pool exists.
+   * If so stop new allocations and kick off the waiters.
    */
-  dyn_semaphore_t *dyn_sem =
-      chFactoryFindSemaphore(PKT_SEND_BUFFER_SEM_NAME);
-  chDbgAssert(dyn_sem != NULL, "common packet semaphore does not exist");
-  if(dyn_sem == NULL)
+  chDbgAssert(pkt_buffer_pool_ref != NULL, "common packet pool does not exist");
+  if(pkt_buffer_pool_ref == NULL)
     return;
   chSysLock();
-  chSemWaitTimeoutS(chFactoryGetSemaphore(dyn_sem), TIME_INFINITE);
+  pkt_buffer_pool_ref = NULL;
   /*
-   *  Kick everyone off and set available buffers to zero.
-   *  Users need to look for MSG_RESET from wait.
+   *  Waiters are only queued when no buffer is free, so the reset to zero
+   *  keeps the count in step with the pool. They get a NULL packet.
+   *  Buffers still in use are returned to the pool when released.
    */
-  chSemResetI(&dyn_sem->sem, 0);
+  if(chSemGetCounterI(&pkt_buffer_pool.sem) < 0)
+    chSemResetI(&pkt_buffer_pool.sem, 0);
   chSchRescheduleS();
   chSysUnlock();
-  chFactoryReleaseSemaphore(dyn_sem);
 }
 
 /*
  * Send shares a common pool of buffers.
- * @retval MSG_RESET    if the semaphore has been reset using @p chSemReset().
- * @retval MSG_TIMEOUT  if the semaphore has not been signaled or reset within
- *                      the specified timeout.
+ * @retval MSG_OK       if a buffer was allocated.
+ * @retval MSG_TIMEOUT  if no buffer became available within the specified
+ *                      timeout or the pool has been reset.
  */
 msg_t pktGetPacketBuffer(packet_t *pp, sysinterval_t timeout) {
 
-  /* Check if the packet buffer semaphore already exists.
-   * If so we get a pointer to it and get the semaphore.
-   */
-  dyn_semaphore_t *dyn_sem =
-      chFactoryFindSemaphore(PKT_SEND_BUFFER_SEM_NAME);
-
-  chDbgAssert(dyn_sem != NULL, "no send PKT semaphore");
+  chDbgAssert(pkt_buffer_pool_ref != NULL, "no common packet pool");
 
   *pp = NULL;
 
-  if(dyn_sem == NULL)
+  if(pkt_buffer_pool_ref == NULL)
     return MSG_TIMEOUT;
 
-  /* Wait in queue for permission to allocate a buffer. */
-  msg_t msg = chSemWaitTimeout(chFactoryGetSemaphore(dyn_sem), timeout);
+  /* Wait in queue for a buffer object. */
+  void *object = chGuardedPoolAllocTimeout(pkt_buffer_pool_ref, timeout);
 
-  /* Decrease ref count. */
-  chFactoryReleaseSemaphore(dyn_sem);
+  chSysLock();
+  if(object == NULL) {
+    pkt_buffer_stats.fails++;
+  } else if(++pkt_buffer_stats.in_use > pkt_buffer_stats.peak) {
+    pkt_buffer_stats.peak = pkt_buffer_stats.in_use;
+  }
+  chSysUnlock();
 
-  if(msg != MSG_OK)
-    /* This can be MSG_TIMEOUT or MSG_RESET. */
-    return msg;
+  if(object == NULL)
+    return MSG_TIMEOUT;
 
-  /* Allocate buffer.
-   * If this returns null then all heap is consumed.
-   */
-  *pp = ax25_new();
-  if(pp == NULL)
-   return MSG_TIMEOUT;
+  /* Initialize the packet header. */
+  *pp = ax25_new(object);
   return MSG_OK;
 }
 
@@ -986,22 +997,29 @@ msg_t pktGetPacketBuffer(packet_t *pp, sysinterval_t timeout) {
  * A common pool of AX25 buffers used in TX and APRS.
  */
 void pktReleasePacketBuffer(packet_t pp) {
-  /* Check if the packet buffer semaphore exists.
-   * If not this is a system error.
-   */
-  dyn_semaphore_t *dyn_sem =
-      chFactoryFindSemaphore(PKT_SEND_BUFFER_SEM_NAME);
+  chDbgAssert(pkt_buffer_objects != NULL, "no common packet pool");
 
-  chDbgAssert(dyn_sem != NULL, "no general packet buffer semaphore");
-
-  /* Free buffer memory. */
+  /* Invalidate the packet object. */
   ax25_delete(pp);
 
-  /* Signal buffer is available. */
-  chSemSignal(chFactoryGetSemaphore(dyn_sem));
+  if(pp == NULL || pkt_buffer_objects == NULL)
+    return;
 
-  /* Decrease factory ref count. */
-  chFactoryReleaseSemaphore(dyn_sem);
+  chSysLock();
+  pkt_buffer_stats.in_use--;
+  chSysUnlock();
+
+  /* Return buffer to pool and signal it is available (also after deinit). */
+  chGuardedPoolFree(&pkt_buffer_pool, pp);
+}
+
+/*
+ * Get usage statistics of the common packet pool.
+ */
+void pktGetPacketBufferStats(pkt_buffer_stats_t *stats) {
+  chSysLock();
+  *stats = pkt_buffer_stats;
+  chSysUnlock();
 }
 
 /*
@@ -19,7 +19,6 @@
 #define PKT_CALLBACK_TERMINATOR_PREFIX  "cbte_"
 #define PKT_CALLBACK_THD_PREFIX         "cb_"
 
-#define PKT_SEND_BUFFER_SEM_NAME        "pbsem"
 
 
 #define PKT_CALLBACK_WA_SIZE             (1024 * 10)
@@ -144,6 +143,17 @@ typedef struct packetHandlerData {
    */
   uint8_t                   tx_count;
 
+  /**
+   * @brief Accumulated transmit airtime (ms) per traffic class.
+   */
+  uint32_t                  tx_airtime[PKT_TX_CLASS_COUNT];
+
+  /**
+   * @brief Airtime budget per traffic class and for all transmissions.
+   */
+  radio_airtime_bucket_t    tx_budget[PKT_TX_CLASS_COUNT];
+  radio_airtime_bucket_t    tx_budget_total;
+
   /**
    * @brief Pointer to link level protocol data.
    */
@@ -217,6 +227,15 @@ typedef struct packetHandlerData {
   uint16_t                  valid_count;
 } packet_svc_t;
 
+/**
+ * @brief   Usage statistics of the common AX25 packet buffer pool.
+ */
+typedef struct {
+  uint8_t                   in_use;
+  uint8_t                   peak;
+  uint32_t                  fails;
+} pkt_buffer_stats_t;
+
 /*===========================================================================*/
 /* External declarations.                                                    */
 /*===========================================================================*/
@@ -257,8 +276,9 @@ extern "C" {
   void pktReleaseBufferSemaphore(const radio_unit_t radio);
   msg_t pktGetPacketBuffer(packet_t *pp, sysinterval_t timeout);
   void pktReleasePacketBuffer(packet_t pp);
-  dyn_semaphore_t *pktInitBufferControl(void);
+  guarded_memory_pool_t *pktInitBufferControl(void);
   void pktDeinitBufferControl(void);
+  void pktGetPacketBufferStats(pkt_buffer_stats_t *stats);
   packet_svc_t *pktGetServiceObject(radio_unit_t radio);
 #ifdef __cplusplus
 }
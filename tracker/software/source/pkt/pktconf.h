@@ -140,6 +140,7 @@ typedef uint32_t            statusmask_t;    /**< Mask of status identifiers. */
 #define STA_AFSK_INVALID_SWAP       STATUS_MASK(9)
 #define STA_PWM_STREAM_TIMEOUT      STATUS_MASK(10)
 #define STA_PKT_NO_BUFFER           STATUS_MASK(11)
+#define STA_PWM_STREAM_SHED         STATUS_MASK(12)
 
 /**
  * Use this attribute to put variables in CCM.
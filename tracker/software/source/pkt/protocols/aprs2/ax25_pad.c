@@ -153,6 +153,7 @@
  *		ax25_from_text		- Tear apart a text string
  *		ax25_from_frame		- Tear apart an AX.25 frame.  
  *					  Must be called before any other function.
+ *		ax25_from_header	- Pre-encoded header plus information part.
  *
  * Get methods:	....			- Extract destination, source, or digipeater
  *					  address from frame.
@@ -218,15 +219,20 @@ int ax25memdebug_seq (packet_t this_p)
  *
  * Name:	ax25_new
  * 
- * Purpose:	Allocate memory for a new packet object.
+ * Purpose:	Initialize a new packet object taken from the packet pool.
+ *
+ * Inputs:	object	- Pool object of size struct TXpacket.
  *
  * Returns:	Identifier for a new packet object.
  *		In the current implementation this happens to be a pointer.
  *
+ * Description:	Only the header fields are set. The frame data is left as
+ *		is because it is always written by the caller before use.
+ *
  *------------------------------------------------------------------------------*/
 
-packet_t ax25_new (void) {
-	struct TXpacket *this_p;
+packet_t ax25_new (void *object) {
+	struct TXpacket *this_p = object;
 
 
 #if DEBUG 
@@ -251,27 +257,19 @@ packet_t ax25_new (void) {
 #endif
 	}
 
-#if USE_CCM_HEAP_FOR_PKT == TRUE
-    /* Use CCM heap. */
-    extern memory_heap_t *ccm_heap;
-    this_p = chHeapAlloc(ccm_heap, sizeof (struct TXpacket));
-#else /* USE_CCM_HEAP_FOR_PKT != TRUE */
-    /* Use system heap. */
-    this_p = chHeapAlloc(NULL, sizeof (struct TXpacket));
-#endif /* USE_CCM_HEAP_FOR_PKT == TRUE */
-
 	if (this_p == NULL) {
-	  TRACE_ERROR ("PKT  > Can't allocate memory in ax25_new.");
+	  TRACE_ERROR ("PKT  > NULL object passed to ax25_new.");
       return NULL;
 	}
 
-	memset(this_p, 0, sizeof(struct TXpacket));
-
 	this_p->magic1 = MAGIC;
 	this_p->seq = last_seq_num;
 	this_p->magic2 = MAGIC;
 	this_p->num_addr = (-1);
 	this_p->nextp = NULL;
+	this_p->frame_len = 0;
+	this_p->modulo = 0;
+	this_p->frame_data[0] = 0;
 
 	return (this_p);
 }
@@ -280,7 +278,7 @@ packet_t ax25_new (void) {
  *
  * Name:	ax25_delete
  * 
- * Purpose:	Destroy a packet object, freeing up memory it was using.
+ * Purpose:	Destroy a packet object before it is returned to the pool.
  *
  *------------------------------------------------------------------------------*/
 
@@ -312,9 +310,9 @@ void ax25_delete (packet_t this_p)
 		TRACE_ERROR("PKT  > Buffer overflow");
 	}
 	
+	/* The object is returned to the pool by the caller. */
 	this_p->magic1 = 0;
-	this_p->magic1 = 0;
-	chHeapFree(this_p);
+	this_p->magic2 = 0;
 }
 
 
@@ -655,6 +653,100 @@ packet_t ax25_from_frame (unsigned char *fbuf, uint16_t flen)
 }
 
 
+/*------------------------------------------------------------------------------
+ *
+ * Name:	ax25_header_from_text
+ * 
+ * Purpose:	Encode the address, control and PID fields of a UI frame once
+ *		so they can be reused for many frames.
+ *
+ * Inputs:	header	- Header to be filled in.
+ *
+ *		addrs	- Address part in monitor format.  i.e.
+ *				source>dest[,repeater1,repeater2,...]
+ *
+ *		strict	- True to enforce rules for packets sent over the air.
+ *
+ * Returns:	1 for success, 0 if the addresses could not be parsed.
+ *
+ * Description:	The addresses are parsed by ax25_from_text with an empty
+ *		information part.  The packet buffer used for that is
+ *		released again.
+ *
+ *------------------------------------------------------------------------------*/
+
+int ax25_header_from_text (ax25_header_t *header, char *addrs, int strict)
+{
+	char stuff[AX25_MAX_ADDRS * (AX25_MAX_ADDR_LEN + 1) + 2];
+
+	header->len = 0;
+	header->num_addr = 0;
+
+	if (strlen(addrs) + 2 > sizeof(stuff)) {
+	  TRACE_ERROR ("PKT  > Address part too long for header");
+	  return (0);
+	}
+	strlcpy (stuff, addrs, sizeof(stuff));
+	strlcat (stuff, ":", sizeof(stuff));
+
+	packet_t this_p = ax25_from_text (stuff, strict);
+	if (this_p == NULL) {
+	  return (0);
+	}
+
+	memcpy (header->data, this_p->frame_data, this_p->frame_len);
+	header->len = this_p->frame_len;
+	header->num_addr = this_p->num_addr;
+	pktReleasePacketBuffer(this_p);
+
+	return (1);
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Name:	ax25_from_header
+ * 
+ * Purpose:	Construct a frame from a pre-encoded header and the
+ *		information part.
+ *
+ * Inputs:	header	- Header built by ax25_header_from_text.
+ *
+ *		info	- Information part.  Copied as is, there is no
+ *			  translation of <0xff> as in ax25_from_text.
+ *
+ *		info_len - Length of information part.
+ *
+ * Returns:	Pointer to new packet object or NULL if error.
+ *
+ *------------------------------------------------------------------------------*/
+
+packet_t ax25_from_header (const ax25_header_t *header, const unsigned char *info, uint16_t info_len)
+{
+	packet_t this_p;
+
+	if (header->len < AX25_MIN_PACKET_LEN
+	    || info_len > AX25_MAX_INFO_LEN
+	    || header->len + info_len > AX25_MAX_PACKET_LEN) {
+	  TRACE_ERROR ("PKT  > Header length %d or info length %d invalid", header->len, info_len);
+	  return (NULL);
+	}
+
+	if(pktGetPacketBuffer(&this_p, TIME_INFINITE) != MSG_OK) {
+	  TRACE_ERROR("PKT  > No packet buffer available");
+	  return NULL;
+	}
+
+	memcpy (this_p->frame_data, header->data, header->len);
+	memcpy (this_p->frame_data + header->len, info, info_len);
+	this_p->frame_len = header->len + info_len;
+	this_p->frame_data[this_p->frame_len] = 0;
+	this_p->num_addr = header->num_addr;
+
+	return (this_p);
+}
+
+
 /*------------------------------------------------------------------------------
  *
  * Name:	ax25_dup
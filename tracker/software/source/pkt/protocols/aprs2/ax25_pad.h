@@ -161,9 +161,20 @@ typedef struct TXpacket {
  */
 typedef struct TXpacket *packet_t;
 
+/*
+ * Pre-encoded address, control and PID fields of outgoing frames.
+ * Built once by ax25_header_from_text and copied into each new frame
+ * by ax25_from_header so only the information part is built per packet.
+ */
+typedef struct ax25_header_s {
+	int num_addr;
+	uint16_t len;
+	unsigned char data[AX25_MAX_ADDRS * AX25_ADDR_LEN + 2];
+} ax25_header_t;
+
 typedef enum cmdres_e { cr_00 = 2, cr_cmd = 1, cr_res = 0, cr_11 = 3 } cmdres_t;
 
-extern packet_t ax25_new (void);
+extern packet_t ax25_new (void *object);
 
 
 /*
@@ -361,6 +372,9 @@ extern int ax25_check_addresses (packet_t pp);
 
 extern packet_t ax25_unwrap_third_party (packet_t from_pp);
 
+extern int ax25_header_from_text (ax25_header_t *header, char *addrs, int strict);
+extern packet_t ax25_from_header (const ax25_header_t *header, const unsigned char *info, uint16_t info_len);
+
 extern void ax25_set_addr (packet_t pp, int, char *);
 extern void ax25_insert_addr (packet_t this_p, int n, char *ad);
 extern void ax25_remove_addr (packet_t this_p, int n);
@@ -60,7 +60,6 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>	/* for isdigit, isupper */
-#include "crx.h"
 
 #include "ax25_pad.h"
 #include "digipeater.h"
@@ -73,6 +72,140 @@
 
 
 
+/*------------------------------------------------------------------------------
+ *
+ * Name:	digipeat_compile
+ *
+ * Purpose:	Compile an alias pattern into a matcher once at configuration time.
+ *
+ * Input:	pattern		- Alternatives separated by "|".  Each one is a
+ *				  literal call prefix, optionally followed by a
+ *				  character range and an SSID.
+ *				  e.g. "WIDE[4-7]-[1-7]|CITYD"
+ *				  An alternative without SSID matches any SSID.
+ *
+ * Outputs:	matcher		- Compiled rules.
+ *
+ * Returns:	true if the pattern was compiled.
+ *		false for syntax not supported by the matcher.
+ *		The matcher is then left empty and matches nothing.
+ *
+ * Description:	The matcher replaces the regular expression interpreter
+ *		on the per frame path.  Unlike a regex search a rule has to
+ *		match the complete call (without SSID).
+ *
+ *------------------------------------------------------------------------------*/
+
+static bool digipeat_compile_range (const char **p, char *lo, char *hi) {
+	const char *s = *p;
+	if (s[0] == '[' && s[1] && s[2] == '-' && s[3] && s[4] == ']' && s[1] <= s[3]) {
+	  *lo = s[1];
+	  *hi = s[3];
+	  *p = s + 5;
+	  return true;
+	}
+	if (isdigit((int)s[0])) {
+	  *lo = *hi = s[0];
+	  *p = s + 1;
+	  return true;
+	}
+	return false;
+}
+
+static bool digipeat_compile_rules (const char *pattern, digi_matcher_t *matcher) {
+	const char *p = pattern;
+	matcher->num_rules = 0;
+
+	while (*p) {
+	  if (matcher->num_rules >= DIGI_MAX_RULES) {
+	    return false;
+	  }
+	  digi_rule_t *rule = &matcher->rule[matcher->num_rules];
+	  memset(rule, 0, sizeof(*rule));
+	  rule->ssid_min = rule->ssid_max = -1;
+
+	  while (isupper((int)*p) || isdigit((int)*p)) {
+	    if (rule->prefix_len >= AX25_MAX_ADDR_LEN - 1) {
+	      return false;
+	    }
+	    rule->prefix[rule->prefix_len++] = *p++;
+	  }
+	  if (*p == '[' && !digipeat_compile_range(&p, &rule->c_min, &rule->c_max)) {
+	    return false;
+	  }
+	  if (*p == '-') {
+	    char lo, hi;
+	    p++;
+	    if (!digipeat_compile_range(&p, &lo, &hi) || !isdigit((int)lo) || !isdigit((int)hi)) {
+	      return false;
+	    }
+	    rule->ssid_min = lo - '0';
+	    rule->ssid_max = hi - '0';
+	  }
+	  if (rule->prefix_len == 0 && rule->c_min == 0) {
+	    return false;
+	  }
+	  matcher->num_rules++;
+
+	  if (*p == '|') {
+	    p++;
+	  }
+	  else if (*p) {
+	    return false;
+	  }
+	}
+	return true;
+}
+
+bool digipeat_compile (const char *pattern, digi_matcher_t *matcher) {
+	if (!digipeat_compile_rules(pattern, matcher)) {
+	  matcher->num_rules = 0;
+	  return false;
+	}
+	return true;
+}
+
+/*------------------------------------------------------------------------------
+ *
+ * Name:	digipeat_alias_match
+ *
+ * Purpose:	Test a call against a compiled alias pattern.
+ *
+ * Input:	matcher		- Compiled pattern.
+ *
+ *		call		- Call without SSID.
+ *
+ *		ssid		- SSID of the call.
+ *
+ * Returns:	true if any rule matches.
+ *
+ *------------------------------------------------------------------------------*/
+
+bool digipeat_alias_match (const digi_matcher_t *matcher, const char *call, int ssid) {
+	for (int i = 0; i < matcher->num_rules; i++) {
+	  const digi_rule_t *rule = &matcher->rule[i];
+	  const char *c = call + rule->prefix_len;
+
+	  if (strncmp(call, rule->prefix, rule->prefix_len) != 0) {
+	    continue;
+	  }
+	  if (rule->c_min != 0) {
+	    if (*c < rule->c_min || *c > rule->c_max) {
+	      continue;
+	    }
+	    c++;
+	  }
+	  if (*c != '\0') {
+	    continue;
+	  }
+	  if (rule->ssid_min >= 0 && (ssid < rule->ssid_min || ssid > rule->ssid_max)) {
+	    continue;
+	  }
+	  return true;
+	}
+	return false;
+}
+
 /*------------------------------------------------------------------------------
  *
  * Name:	digipeat_match
@@ -119,7 +252,8 @@
 				  
 
 packet_t digipeat_match (int from_chan, packet_t pp, char *mycall_rec,
-                         char *mycall_xmit, char *alias, char *wide,
+                         char *mycall_xmit, const digi_matcher_t *alias,
+                         const digi_matcher_t *wide,
                          int to_chan, enum preempt_e preempt,
                          char *filter_str) {
 	(void)from_chan;
@@ -129,7 +263,7 @@ packet_t digipeat_match (int from_chan, packet_t pp, char *mycall_rec,
 	int ssid;
 	int r;
 	char repeater[AX25_MAX_ADDR_LEN];
-	int found_len;
+	char repeater_call[AX25_MAX_ADDR_LEN];
 
 
 
@@ -146,6 +280,7 @@ packet_t digipeat_match (int from_chan, packet_t pp, char *mycall_rec,
 
 	ax25_get_addr_with_ssid(pp, r, repeater);
 	ssid = ax25_get_ssid(pp, r);
+	ax25_get_addr_no_ssid(pp, r, repeater_call);
 
 
 /*
@@ -215,8 +350,7 @@ packet_t digipeat_match (int from_chan, packet_t pp, char *mycall_rec,
  * My call should be an implied member of this set.
  * In this implementation, we already caught it further up.
  */
-	regex(alias, repeater, &found_len);
-	if(found_len) {
+	if (digipeat_alias_match(alias, repeater_call, ssid)) {
 	  packet_t result;
 
 	  result = ax25_dup (pp);
@@ -238,13 +372,13 @@ packet_t digipeat_match (int from_chan, packet_t pp, char *mycall_rec,
 
 	  for (r2 = r+1; r2 < ax25_get_num_addr(pp); r2++) {
 	    char repeater2[AX25_MAX_ADDR_LEN];
+	    char repeater2_call[AX25_MAX_ADDR_LEN];
 
 	    ax25_get_addr_with_ssid(pp, r2, repeater2);
-
-		regex(alias, repeater2, &found_len);
+	    ax25_get_addr_no_ssid(pp, r2, repeater2_call);
 
 	    if (strcmp(repeater2, mycall_rec) == 0 ||
-	      found_len != 0) {
+	      digipeat_alias_match(alias, repeater2_call, ax25_get_ssid(pp, r2))) {
 	      packet_t result;
 
 	      result = ax25_dup (pp);
@@ -287,8 +421,7 @@ packet_t digipeat_match (int from_chan, packet_t pp, char *mycall_rec,
 /*
  * For the wide pattern, we check the ssid and decrement it.
  */
-	regex(wide, repeater, &found_len);
-	if (found_len != 0) {
+	if (digipeat_alias_match(wide, repeater_call, ssid)) {
 
 /*
  * If ssid == 1, we simply replace the repeater with my call and
@@ -1,13 +1,32 @@
 #ifndef DIGIPEATER_H
 #define DIGIPEATER_H 1
 
-#include "regex.h"
-
 #include "ax25_pad.h"		/* for packet_t */
 
 
+#define DIGI_MAX_RULES 8
+
+/*
+ * One alternative of a compiled alias pattern.
+ * Matches a call made of a literal prefix, an optional character range
+ * (e.g. WIDE[1-7]) and an optional SSID range (e.g. -[1-7]).
+ */
+typedef struct digi_rule_s {
+	char prefix[AX25_MAX_ADDR_LEN];
+	int prefix_len;
+	char c_min, c_max;	/* Range of the character after the prefix, 0 if none. */
+	int ssid_min, ssid_max;	/* SSID range, -1 for any SSID. */
+} digi_rule_t;
+
+typedef struct digi_matcher_s {
+	digi_rule_t rule[DIGI_MAX_RULES];
+	int num_rules;
+} digi_matcher_t;
+
 enum preempt_e { PREEMPT_OFF, PREEMPT_DROP, PREEMPT_MARK, PREEMPT_TRACE };
-packet_t digipeat_match (int from_chan, packet_t pp, char *mycall_rec, char *mycall_xmit, char *alias, char *wide, int to_chan, enum preempt_e preempt, char *filter_str);
+bool digipeat_compile (const char *pattern, digi_matcher_t *matcher);
+bool digipeat_alias_match (const digi_matcher_t *matcher, const char *call, int ssid);
+packet_t digipeat_match (int from_chan, packet_t pp, char *mycall_rec, char *mycall_xmit, const digi_matcher_t *alias, const digi_matcher_t *wide, int to_chan, enum preempt_e preempt, char *filter_str);
 
 #endif 
 
@@ -19,6 +19,7 @@
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
+#include <ctype.h>
 #include "debug.h"
 #include "base91.h"
 #include "digipeater.h"
@@ -36,13 +37,24 @@ typedef struct {
 	char call[AX25_MAX_ADDR_LEN];
 } heard_t;
 
+typedef struct {
+	char call[AX25_MAX_ADDR_LEN];
+	char path[APRS_PATH_LENGTH];
+	ax25_header_t header;
+} aprs_header_t;
+
 
 static uint16_t msg_id;
 char alias_re[] = "WIDE[4-7]-[1-7]|CITYD";
 char wide_re[] = "WIDE[1-7]-[1-7]";
 enum preempt_e preempt = PREEMPT_OFF;
 static heard_t heard_list[APRS_HEARD_LIST_SIZE];
-static bool dedupe_initialized;
+static bool digi_initialized;
+static digi_matcher_t alias_matcher;
+static digi_matcher_t wide_matcher;
+static aprs_header_t header_cache[APRS_HEADER_CACHE_SIZE];
+static uint8_t header_next;
+static MUTEX_DECL(header_mtx);
 
 const conf_command_t command_list[] = {
 	{TYPE_INT,  "pos_pri.active",                sizeof(conf_sram.pos_pri.beacon.active),                     &conf_sram.pos_pri.beacon.active                    },
@@ -92,6 +104,9 @@ const conf_command_t command_list[] = {
 	{TYPE_STR,  "img_pri.path",                  sizeof(conf_sram.img_pri.path),                              &conf_sram.img_pri.path                             },
 	{TYPE_INT,  "img_pri.res",                   sizeof(conf_sram.img_pri.res),                               &conf_sram.img_pri.res                              },
 	{TYPE_INT,  "img_pri.quality",               sizeof(conf_sram.img_pri.quality),                           &conf_sram.img_pri.quality                          },
+	{TYPE_INT,  "img_pri.packets",               sizeof(conf_sram.img_pri.packets),                           &conf_sram.img_pri.packets                          },
+	{TYPE_INT,  "img_pri.preview",               sizeof(conf_sram.img_pri.preview),                           &conf_sram.img_pri.preview                          },
+	{TYPE_TIME, "img_pri.preview_wait",          sizeof(conf_sram.img_pri.preview_wait),                      &conf_sram.img_pri.preview_wait                     },
 	{TYPE_INT,  "img_pri.buf_size",              sizeof(conf_sram.img_pri.buf_size),                          &conf_sram.img_pri.buf_size                         },
 
 	{TYPE_INT,  "img_sec.active",                sizeof(conf_sram.img_sec.svc_conf.active),                   &conf_sram.img_sec.svc_conf.active                  },
@@ -111,6 +126,9 @@ const conf_command_t command_list[] = {
 	{TYPE_STR,  "img_sec.path",                  sizeof(conf_sram.img_sec.path),                              &conf_sram.img_sec.path                             },
 	{TYPE_INT,  "img_sec.res",                   sizeof(conf_sram.img_sec.res),                               &conf_sram.img_sec.res                              },
 	{TYPE_INT,  "img_sec.quality",               sizeof(conf_sram.img_sec.quality),                           &conf_sram.img_sec.quality                          },
+	{TYPE_INT,  "img_sec.packets",               sizeof(conf_sram.img_sec.packets),                           &conf_sram.img_sec.packets                          },
+	{TYPE_INT,  "img_sec.preview",               sizeof(conf_sram.img_sec.preview),                           &conf_sram.img_sec.preview                          },
+	{TYPE_TIME, "img_sec.preview_wait",          sizeof(conf_sram.img_sec.preview_wait),                      &conf_sram.img_sec.preview_wait                     },
 	{TYPE_INT,  "img_sec.buf_size",              sizeof(conf_sram.img_sec.buf_size),                          &conf_sram.img_sec.buf_size                         },
 
 	{TYPE_INT,  "log.active",                    sizeof(conf_sram.log.svc_conf.active),                       &conf_sram.log.svc_conf.active                      },
@@ -170,6 +188,24 @@ const conf_command_t command_list[] = {
 
     {TYPE_TIME, "tel_enc_cycle",                 sizeof(conf_sram.tel_enc_cycle),                            &conf_sram.tel_enc_cycle                             },
 
+    {TYPE_INT,  "airtime.total",                 sizeof(conf_sram.airtime.total),                             &conf_sram.airtime.total                            },
+    {TYPE_INT,  "airtime.image",                 sizeof(conf_sram.airtime.image),                             &conf_sram.airtime.image                            },
+    {TYPE_INT,  "airtime.telemetry",             sizeof(conf_sram.airtime.telemetry),                         &conf_sram.airtime.telemetry                        },
+    {TYPE_INT,  "airtime.digipeat",              sizeof(conf_sram.airtime.digipeat),                          &conf_sram.airtime.digipeat                         },
+    {TYPE_INT,  "airtime.beacon",                sizeof(conf_sram.airtime.beacon),                            &conf_sram.airtime.beacon                           },
+    {TYPE_TIME, "airtime.window",                sizeof(conf_sram.airtime.window),                            &conf_sram.airtime.window                           },
+    {TYPE_TIME, "airtime.max_defer",             sizeof(conf_sram.airtime.max_defer),                         &conf_sram.airtime.max_defer                        },
+    {TYPE_TIME, "airtime.listen",                sizeof(conf_sram.airtime.listen),                            &conf_sram.airtime.listen                           },
+    {TYPE_TIME, "airtime.listen_max",            sizeof(conf_sram.airtime.listen_max),                        &conf_sram.airtime.listen_max                       },
+    {TYPE_INT,  "airtime.listen_every",          sizeof(conf_sram.airtime.listen_every),                      &conf_sram.airtime.listen_every                     },
+
+    {TYPE_INT,  "power.enabled",                 sizeof(conf_sram.power.enabled),                             &conf_sram.power.enabled                            },
+    {TYPE_INT,  "power.capacity",                sizeof(conf_sram.power.capacity),                            &conf_sram.power.capacity                           },
+    {TYPE_INT,  "power.soc_min",                 sizeof(conf_sram.power.soc_min),                             &conf_sram.power.soc_min                            },
+    {TYPE_INT,  "power.soc_nominal",             sizeof(conf_sram.power.soc_nominal),                         &conf_sram.power.soc_nominal                        },
+    {TYPE_INT,  "power.scale_min",               sizeof(conf_sram.power.scale_min),                           &conf_sram.power.scale_min                          },
+    {TYPE_INT,  "power.scale_max",               sizeof(conf_sram.power.scale_max),                           &conf_sram.power.scale_max                          },
+
 	{TYPE_NULL}
 };
 
@@ -284,6 +320,60 @@ void aprs_debug_getPacket(packet_t pp, char* buf, uint32_t len)
     }
 }
 
+/**
+ * @brief  Build an outgoing packet from a pre-encoded header.
+ * @notes  The AX.25 addresses for a call sign and path are encoded once
+ *         and kept in a small cache. Only the info field is copied for
+ *         each packet. The info field is used as is (no <0xNN> translation).
+ *
+ * @param[in] callsign  origination call sign
+ * @param[in] path      path to use
+ * @param[in] info      info field
+ * @param[in] len       length of info field
+ *
+ * @return    encoded packet object pointer
+ * @retval    NULL if encoding failed
+ */
+static packet_t aprs_encode_frame(const char *callsign, const char *path,
+                                  const char *info, uint16_t len) {
+  ax25_header_t header;
+  bool cacheable = strlen(callsign) < AX25_MAX_ADDR_LEN
+      && strlen(path) < APRS_PATH_LENGTH;
+
+  chMtxLock(&header_mtx);
+  bool found = false;
+  for(uint8_t i = 0; cacheable && i < APRS_HEADER_CACHE_SIZE; i++) {
+    if(header_cache[i].header.len != 0
+        && !strcmp(header_cache[i].call, callsign)
+        && !strcmp(header_cache[i].path, path)) {
+      header = header_cache[i].header;
+      found = true;
+      break;
+    }
+  }
+  chMtxUnlock(&header_mtx);
+
+  if(!found) {
+    char addrs[AX25_MAX_ADDR_LEN + sizeof(APRS_DEVICE_CALLSIGN)
+               + APRS_PATH_LENGTH + 2];
+    chsnprintf(addrs, sizeof(addrs), "%s>%s,%s", callsign,
+               APRS_DEVICE_CALLSIGN, path);
+    if(!ax25_header_from_text(&header, addrs, true))
+      return NULL;
+    if(cacheable) {
+      /* Replace the oldest entry. */
+      chMtxLock(&header_mtx);
+      aprs_header_t *entry = &header_cache[header_next];
+      header_next = (header_next + 1) % APRS_HEADER_CACHE_SIZE;
+      strcpy(entry->call, callsign);
+      strcpy(entry->path, path);
+      entry->header = header;
+      chMtxUnlock(&header_mtx);
+    }
+  }
+  return ax25_from_header(&header, (const unsigned char *)info, len);
+}
+
 /**
  * @brief  Transmit APRS position packet.
  *
@@ -334,10 +424,7 @@ packet_t aprs_encode_stamped_position_and_telemetry(const char *callsign,
     /* RTC is not set so use dataPoint (it may have a valid date). */
     unixTimestamp2Date(&time, dataPoint->gps_time);
   char xmit[256];
-  uint32_t len = chsnprintf(xmit, sizeof(xmit), "%s>%s,%s:@%02d%02d%02dz",
-                            callsign,
-                            APRS_DEVICE_CALLSIGN,
-                            path,
+  uint32_t len = chsnprintf(xmit, sizeof(xmit), "@%02d%02d%02dz",
                             time.day,
                             time.hour,
                             time.minute);
@@ -389,9 +476,8 @@ packet_t aprs_encode_stamped_position_and_telemetry(const char *callsign,
   /* Digital bits second byte - set zero. */
   xmit[len+len2+27] = 33;
   xmit[len+len2+28] = '|';
-  xmit[len+len2+29] = 0;
 
-  return ax25_from_text(xmit, true);
+  return aprs_encode_frame(callsign, path, xmit, len+len2+29);
 }
 
 /**
@@ -445,10 +531,8 @@ packet_t aprs_encode_position_and_telemetry(const char *callsign,
 	uint32_t a1r = a % 91;
 
 	char xmit[256];
-    uint32_t len = chsnprintf(xmit, sizeof(xmit), "%s>%s,%s:=",
-                              callsign,
-                              APRS_DEVICE_CALLSIGN,
-                              path);
+    uint32_t len = 0;
+    xmit[len++] = '=';
 
     uint8_t gpsFix = dataPoint->gps_state == GPS_LOCKED1
         || dataPoint->gps_state == GPS_LOCKED2
@@ -504,22 +588,36 @@ packet_t aprs_encode_position_and_telemetry(const char *callsign,
     /* Digital bits second byte - set zero. */
     xmit[len+len2+27] = 33;
     xmit[len+len2+28] = '|';
-	xmit[len+len2+29] = 0;
 
-	return ax25_from_text(xmit, true);
+	return aprs_encode_frame(callsign, path, xmit, len+len2+29);
 }
 
-/*
+/**
+ * @brief  Encode a binary data packet (image or log).
+ * @notes  The data is base91 encoded directly into the info field.
  *
+ * @param[in] callsign   origination call sign
+ * @param[in] path       path to use
+ * @param[in] packetType packet type character
+ * @param[in] data       binary data
+ * @param[in] len        length of data
+ *
+ * @return    encoded packet object pointer
+ * @retval    NULL if encoding failed
  */
 packet_t aprs_encode_data_packet(const char *callsign, const char *path,
-                                 char packetType, uint8_t *data)
+                                 char packetType, const uint8_t *data,
+                                 uint16_t len)
 {
 	char xmit[256];
-	chsnprintf(xmit, sizeof(xmit), "%s>%s,%s:{{%c%s", callsign,
-	           APRS_DEVICE_CALLSIGN, path, packetType, data);
-
-	return ax25_from_text(xmit, true);
+	if((size_t)BASE91LEN(len) + 3 > sizeof(xmit))
+		return NULL;
+	xmit[0] = '{';
+	xmit[1] = '{';
+	xmit[2] = packetType;
+	size_t n = base91_encode(data, (uint8_t*)&xmit[3], len);
+
+	return aprs_encode_frame(callsign, path, xmit, n + 3);
 }
 
 /**
@@ -540,22 +638,16 @@ packet_t aprs_format_transmit_message(const char *originator, const char *path,
 	  /* Invalid message. */
 	  return NULL;
 	if(!ack)
-		chsnprintf(xmit, sizeof(xmit), "%s>%s,%s::%-9s:%s",
-		                               originator,
-		                               APRS_DEVICE_CALLSIGN,
-                                       path,
+		chsnprintf(xmit, sizeof(xmit), "::%-9s:%s",
                                        recipient,
                                        text);
 	else
-		chsnprintf(xmit, sizeof(xmit), "%s>%s,%s::%-9s:%s{%d",
-                                       originator,
-                                       APRS_DEVICE_CALLSIGN,
-                                       path,
+		chsnprintf(xmit, sizeof(xmit), "::%-9s:%s{%d",
                                        recipient,
                                        text,
                                        ++msg_id);
 
-	return ax25_from_text(xmit, true);
+	return aprs_encode_frame(originator, path, xmit, strlen(xmit));
 }
 
 /*
@@ -615,7 +707,8 @@ msg_t aprs_send_aprsd_message(aprs_identity_t *id,
                   0,
                   id->pwr,
                   id->mod,
-                  id->cca)) {
+                  id->cca,
+                  PKT_TX_CLASS_TELEMETRY)) {
     TRACE_ERROR("TX   > APRSD: Transmit failed");
     return MSG_ERROR;
   }
@@ -668,7 +761,8 @@ msg_t aprs_send_aprsh_message(aprs_identity_t *id,
                   0,
                   id->pwr,
                   id->mod,
-                  id->cca)) {
+                  id->cca,
+                  PKT_TX_CLASS_TELEMETRY)) {
     TRACE_ERROR("TX   > APRSH: Transmit failed");
     return MSG_ERROR;
   }
@@ -829,7 +923,8 @@ msg_t aprs_execute_gpio_command(aprs_identity_t *id,
               0,
               id->pwr,
               id->mod,
-              id->cca)) {
+              id->cca,
+              PKT_TX_CLASS_TELEMETRY)) {
     TRACE_ERROR("RX   > Transmit of GPIO status failed");
     return MSG_ERROR;
   }
@@ -908,7 +1003,8 @@ msg_t aprs_execute_system_reset(aprs_identity_t *id,
                   0,
                   id->pwr,
                   id->mod,
-                  id->cca);
+                  id->cca,
+                  PKT_TX_CLASS_TELEMETRY);
 
   chThdSleep(TIME_S2I(10));
 
@@ -1026,24 +1122,38 @@ msg_t aprs_execute_img_command(aprs_identity_t *id,
 
     /* Start at arg 2. */
     int c = 2;
-    while(c <= argc) {
+    while(c < argc) {
       uint32_t req = strtol(argv[c++], NULL, 16);
-      for(uint8_t i = 0; i < 16; i++) {
-        /* Find an empty repeat slot. */
-        if(!packetRepeats[i].n_done) {
-          packetRepeats[i].image_id = (req >> 16) & 0xFF;
-          packetRepeats[i].packet_id = req & 0xFFFF;
-          packetRepeats[i].n_done = true;
-
-          TRACE_INFO("RX   > ... Image %3d Packet %3d",
-                     packetRepeats[i].image_id,
-                     packetRepeats[i].packet_id);
-          break;
-        } /* Not an empty slot. */
-      } /* No more slots. */
+      const uint8_t bit = 0x80;
+      if(image_request_repeat((req >> 16) & 0xFF, req & 0xFFFF, &bit, 1))
+        TRACE_INFO("RX   > ... Image %3d Packet %3d",
+                   (req >> 16) & 0xFF, req & 0xFFFF);
     } /* No more image IDs. */
     return MSG_OK;
   }
+
+  /*
+   * Selective repeat request.
+   * Format is "nack IIPPPP BITMAP" with all fields in hex.
+   * II is the image ID and PPPP the first packet ID of the bitmap.
+   * The MSB of the first bitmap digit is packet PPPP.
+   */
+  if(!strcmp(argv[0], "nack") && argc == 3) {
+    uint32_t req = strtol(argv[1], NULL, 16);
+    uint8_t bitmap[IMG_REPEAT_PACKETS / 8] = {0};
+    uint16_t bits = 0;
+    for(char *p = argv[2]; *p != '\0'; p++, bits += 4) {
+      if(bits >= IMG_REPEAT_PACKETS || !isxdigit((int)*p))
+        return MSG_ERROR;
+      uint8_t v = isdigit((int)*p) ? *p - '0' : tolower((int)*p) - 'a' + 10;
+      bitmap[bits / 8] |= (bits % 8) ? v : v << 4;
+    }
+    uint16_t n = image_request_repeat((req >> 16) & 0xFF, req & 0xFFFF,
+                                      bitmap, bits);
+    TRACE_INFO("RX   > Message: Image %d NACK from packet %d, %d queued",
+               (req >> 16) & 0xFF, req & 0xFFFF, n);
+    return MSG_OK;
+  }
   /* Unknown parameter. */
   return MSG_ERROR;
 }
@@ -1247,7 +1357,8 @@ static bool aprs_decode_message(packet_t pp) {
                     0,
                     identity.pwr,
                     identity.mod,
-                    identity.cca);
+                    identity.cca,
+                    PKT_TX_CLASS_TELEMETRY);
   }
   /* Flag that the APRS content should not be digipeated. */
   return false;
@@ -1257,15 +1368,22 @@ static bool aprs_decode_message(packet_t pp) {
  * Transmit failure will release the packet memory.
  */
 static void aprs_digipeat(packet_t pp) {
-  if(!dedupe_initialized) {
+  if(!digi_initialized) {
     dedupe_init(TIME_S2I(10));
-    dedupe_initialized = true;
+    /* Compile the alias patterns once rather than per received frame. */
+    if(!digipeat_compile(alias_re, &alias_matcher))
+      TRACE_ERROR("RX   > Digipeater alias pattern %s not supported, "
+                  "aliases disabled", alias_re);
+    if(!digipeat_compile(wide_re, &wide_matcher))
+      TRACE_ERROR("RX   > Digipeater wide pattern %s not supported, "
+                  "wide aliases disabled", wide_re);
+    digi_initialized = true;
   }
 
   if(!dedupe_check(pp, 0)) { // Last identical packet older than 10 seconds
     packet_t result = digipeat_match(0, pp, conf_sram.aprs.rx.call,
-                                     conf_sram.aprs.tx.call, alias_re,
-                                     wide_re, 0, preempt, NULL);
+                                     conf_sram.aprs.tx.call, &alias_matcher,
+                                     &wide_matcher, 0, preempt, NULL);
     if(result != NULL) { // Should be digipeated
       /* Remember the transmission. Frequency may be a code or absolute. */
       dedupe_remember(result, conf_sram.aprs.tx.radio_conf.freq);
@@ -1276,7 +1394,8 @@ static void aprs_digipeat(packet_t pp) {
                       0,
                       conf_sram.aprs.tx.radio_conf.pwr,
                       conf_sram.aprs.tx.radio_conf.mod,
-                      conf_sram.aprs.tx.radio_conf.cca)) {
+                      conf_sram.aprs.tx.radio_conf.cca,
+                      PKT_TX_CLASS_DIGIPEAT)) {
         TRACE_INFO("RX   > Failed to digipeat packet");
       } /* TX failed. */
     } /* Should be digipeated. */
@@ -56,6 +56,9 @@
 
 #define APRS_HEARD_LIST_SIZE            20
 
+/* Number of call/path combinations with a pre-encoded AX.25 header. */
+#define APRS_HEADER_CACHE_SIZE          8
+
 #define APRS_MAX_MSG_ARGUMENTS          10
 
 typedef struct APRSIdentity {
@@ -106,7 +109,8 @@ extern "C" {
                                const char *receiver, const char *text,
                                const bool ack);
   packet_t  aprs_encode_data_packet(const char *callsign, const char *path,
-                                   char packetType, uint8_t *data);
+                                   char packetType, const uint8_t *data,
+                                   uint16_t len);
   packet_t  aprs_compose_aprsd_message(const char *callsign, const char *path,
                                    const char *receiver);
   void      aprs_decode_packet(packet_t pp);
@@ -419,6 +419,19 @@ static char ssdv_out_jpeg_int(ssdv_t *s, uint8_t rle, int value)
 	return(SSDV_OK);
 }
 
+/*
+ * Called by the encoder after an absolute DC value of the reset MCU.
+ * If the packet is full and the last bits of the value go into the next
+ * packet, the decoder reads the value after it has seen the header of the
+ * next packet. A decoder takes the MCU of that header as the new reset MCU
+ * right away and would read the value as relative. So the next packet must
+ * not start a new MCU, the decoder then keeps the reset MCU.
+ */
+static void ssdv_test_reset_spill(ssdv_t *s)
+{
+	if(s->out_len == 0 && s->outlen > 0) s->no_mcu_packet = s->packet_id + 1;
+}
+
 static char ssdv_process(ssdv_t *s)
 {
 	if(s->state == S_HUFF)
@@ -437,7 +450,11 @@ static char ssdv_process(ssdv_t *s)
 				/* No change in DC from last block */
 				if(s->reset_mcu == s->mcu_id && (s->mcupart == 0 || s->mcupart >= s->ycparts))
 				{
-					if(s->mode == S_ENCODING) ssdv_out_jpeg_int(s, 0, s->adc[s->component]);
+					if(s->mode == S_ENCODING)
+					{
+						ssdv_out_jpeg_int(s, 0, s->adc[s->component]);
+						ssdv_test_reset_spill(s);
+					}
 					else
 					{
 						ssdv_out_jpeg_int(s, 0, 0 - s->dc[s->component]);
@@ -505,6 +522,7 @@ static char ssdv_process(ssdv_t *s)
 					s->dc[s->component] += UADJ(i);
 					s->adc[s->component] = AADJ(s->dc[s->component]);
 					ssdv_out_jpeg_int(s, 0, s->adc[s->component]);
+					ssdv_test_reset_spill(s);
 				}
 				else
 				{
@@ -584,8 +602,8 @@ static char ssdv_process(ssdv_t *s)
 				return(SSDV_EOI);
 			}
 			
-			/* Set the packet MCU marker - encoder only */
-			if(s->mode == S_ENCODING && s->packet_mcu_id == 0xFFFF)
+			/* Set the packet MCU marker - encoder only, see ssdv_test_reset_spill() */
+			if(s->mode == S_ENCODING && s->packet_mcu_id == 0xFFFF && s->packet_id != s->no_mcu_packet)
 			{
 				/* The first MCU of each packet should be byte aligned */
 				ssdv_outbits_sync(s);
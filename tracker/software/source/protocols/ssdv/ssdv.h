@@ -115,6 +115,7 @@ typedef struct
 		S_DECODING,
 	} mode;
 	uint32_t reset_mcu; /* MCU block to do absolute encoding            */
+	uint16_t no_mcu_packet; /* Packet which must not start an MCU - encoder only */
 	char needbits;      /* Number of bits needed to decode integer      */
 	
 	/* The input huffman and quantisation tables */
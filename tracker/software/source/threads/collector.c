@@ -22,7 +22,9 @@
 #include "pi2c.h"
 #include "si446x.h"
 #include "pflash.h"
+#include "sd.h"
 #include "pkttypes.h"
+#include "power.h"
 
 /*===========================================================================*/
 /* Module local variables.                                                   */
@@ -156,17 +158,22 @@ static bool aquirePosition(dataPoint_t* tp, dataPoint_t* ltp,
   /*
    *  Search for GPS lock within the timeout period and while battery is good.
    *  Search timeout=cycle-1sec (-3sec in order to keep synchronization)
+   *  The wait for a fix is done in slices so that battery and GPS model are
+   *  checked periodically. A fix is handed over as soon as it is received.
    */
-  uint32_t x = 0;
+  sysinterval_t elapsed;
   gps_set_model(dynamic);
-  do {
+  while((elapsed = chVTTimeElapsedSinceX(start)) < timeout) {
+    sysinterval_t slice = timeout - elapsed;
+    if(slice > COLL_GPS_WAIT_SLICE)
+      slice = COLL_GPS_WAIT_SLICE;
+    if(gps_wait_fix(&gpsFix, slice))
+      break;
     batt = stm32_get_vbat();
-    if(++x % 30) gps_set_model(dynamic); // Set model periodically
-    chThdSleepMilliseconds(100);
-    gps_get_fix(&gpsFix);
-  } while(!isGPSLocked(&gpsFix)
-      && batt >= conf_sram.gps_off_vbat
-      && chVTIsSystemTimeWithin(start, start + timeout));
+    if(batt < conf_sram.gps_off_vbat)
+      break;
+    gps_set_model(dynamic); // Set model periodically
+  }
 
   if(batt < conf_sram.gps_off_vbat) {
     /*
@@ -260,6 +267,144 @@ static bool aquirePosition(dataPoint_t* tp, dataPoint_t* ltp,
   return true;
 }
 
+/*===========================================================================*/
+/* Sensor sampling scheduler.                                                */
+/*===========================================================================*/
+
+/*
+ * The BME280s are run in forced mode. Conversions are started on all fitted
+ * sensors together and the ADC and PAC1720 are read while they convert.
+ * Readings are cached per sensor. A request within COLL_SENSOR_FRESH_TIME of
+ * the last sample reuses the cached reading without touching the bus.
+ */
+static bme280_sensor_t bme280_sensors[] = {
+  {.id = BME280_I1, .fitted = true},
+#if     ENABLE_EXTERNAL_I2C == TRUE
+  {.id = BME280_E1, .fitted = BME280_E1_IS_FITTED},
+  {.id = BME280_E2, .fitted = BME280_E2_IS_FITTED},
+#else
+  {.id = BME280_E1, .fitted = false},
+  {.id = BME280_E2, .fitted = false},
+#endif
+};
+
+static adc_sample_cache_t adc_cache;
+static systime_t bme280_trigger_time;
+static bool bme280_triggered;
+static MUTEX_DECL(sensor_mtx);
+
+/**
+ * @brief   Is a cached reading still fresh.
+ *
+ * @param[in]   valid   cached reading is valid
+ * @param[in]   time    system time the reading was taken
+ *
+ * @notapi
+ */
+static bool isSampleFresh(bool valid, systime_t time) {
+  return valid && chVTTimeElapsedSinceX(time) < COLL_SENSOR_FRESH_TIME;
+}
+
+/**
+ * @brief   Start conversions on all fitted BME280s with stale readings.
+ * @notes   Calibration data is read only once per sensor.
+ * @notes   bme280_triggered is set if any conversion was started.
+ *
+ * @notapi
+ */
+static void startSensorConversions(void) {
+  bme280_trigger_time = chVTGetSystemTimeX();
+  bme280_triggered = false;
+  for(uint8_t i = 0; i < sizeof(bme280_sensors)/sizeof(bme280_sensor_t); i++) {
+    bme280_sensor_t *sen = &bme280_sensors[i];
+    sen->triggered = false;
+    if(!sen->fitted || isSampleFresh(sen->valid, sen->time))
+      continue;
+    if(!BME280_isAvailable(sen->id)) {
+      /* Read calibration again when the sensor comes back. */
+      sen->setup = false;
+      sen->valid = false;
+      continue;
+    }
+    if(!sen->setup) {
+      BME280_Setup(&sen->handle, sen->id);
+      sen->setup = true;
+    }
+    sen->triggered = BME280_Trigger(&sen->handle);
+    bme280_triggered |= sen->triggered;
+    sen->valid = false;
+  }
+}
+
+/**
+ * @brief   Sample the ADC if the cached sample is stale.
+ *
+ * @notapi
+ */
+static void sampleADC(void) {
+  if(isSampleFresh(adc_cache.valid, adc_cache.time))
+    return;
+  stm32_get_adc(&adc_cache.vbat, &adc_cache.vsol, &adc_cache.temp);
+  adc_cache.time = chVTGetSystemTimeX();
+  adc_cache.valid = true;
+}
+
+/**
+ * @brief   Wait for triggered conversions and read the results.
+ * @notes   Only the remainder of the conversion time is waited for and
+ *          nothing if all readings came from the cache.
+ *
+ * @post    The provided data point (record) is updated.
+ *
+ * @param[in]   tp   pointer to a @p datapoint structure
+ *
+ * @notapi
+ */
+static void finishSensorConversions(dataPoint_t* tp) {
+  if(bme280_triggered)
+    chThdSleepUntilWindowed(bme280_trigger_time,
+                            bme280_trigger_time + BME280_MEASURE_TIME);
+
+  bme280_error = 0;
+  for(uint8_t i = 0; i < sizeof(bme280_sensors)/sizeof(bme280_sensor_t); i++) {
+    bme280_sensor_t *sen = &bme280_sensors[i];
+    if(sen->triggered) {
+      sen->valid = BME280_readData(&sen->handle,
+                                   &sen->press, &sen->hum, &sen->temp);
+      sen->time = chVTGetSystemTimeX();
+      sen->triggered = false;
+    }
+    if(!sen->fitted) {
+      bme280_error |= BME_NOT_FITTED_VALUE << (sen->id * BME_STATUS_BITS);
+    } else if(!sen->valid) {
+      TRACE_WARN("COLL > BME280 %s not operational",
+                 sen->id == BME280_I1 ? "I1" : sen->id == BME280_E1 ? "E1" : "E2");
+      sen->press = 0;
+      sen->hum = 0;
+      sen->temp = 0;
+      bme280_error |= BME_FAIL_VALUE << (sen->id * BME_STATUS_BITS);
+    }
+  }
+
+  tp->sen_i1_press = bme280_sensors[BME280_I1].press;
+  tp->sen_i1_hum = bme280_sensors[BME280_I1].hum;
+  tp->sen_i1_temp = bme280_sensors[BME280_I1].temp;
+  tp->sen_e1_press = bme280_sensors[BME280_E1].press;
+  tp->sen_e1_hum = bme280_sensors[BME280_E1].hum;
+  tp->sen_e1_temp = bme280_sensors[BME280_E1].temp;
+  tp->sen_e2_press = bme280_sensors[BME280_E2].press;
+  tp->sen_e2_hum = bme280_sensors[BME280_E2].hum;
+  tp->sen_e2_temp = bme280_sensors[BME280_E2].temp;
+
+  // Measure various temperature sensors
+  /* TODO: Add LLD API to radio. */
+  tp->stm32_temp = adc_cache.temp;
+  tp->si446x_temp = Si446x_getLastTemperature(PKT_RADIO_1);
+
+  // Measure light intensity from OV5640
+  tp->light_intensity = OV5640_getLastLightIntensity() & 0xFFFF;
+}
+
 /**
  * @brief   Get voltage status and save in datapoint.
  * @notes	The battery and solar voltages are read and stored.
@@ -272,15 +417,36 @@ static bool aquirePosition(dataPoint_t* tp, dataPoint_t* ltp,
  */
 static void measureVoltage(dataPoint_t* tp)
 {
-	tp->adc_vbat = stm32_get_vbat();
-	tp->adc_vsol = stm32_get_vsol();
+	sampleADC();
+	tp->adc_vbat = adc_cache.vbat;
+	tp->adc_vsol = adc_cache.vsol;
 
 	pac1720_get_avg(&tp->pac_vbat, &tp->pac_vsol, &tp->pac_pbat, &tp->pac_psol);
+	power_update(tp->pac_pbat, tp->adc_vbat);
+}
+
+/**
+ * @brief   Get voltage and sensor status and save in datapoint.
+ * @notes	Voltages are measured while the BME280s convert.
+ *
+ * @post    The provided data point (record) is updated.
+ *
+ * @param[in]   tp   pointer to a @p datapoint structure
+ *
+ * @notapi
+ */
+static void getTelemetry(dataPoint_t* tp) {
+  chMtxLock(&sensor_mtx);
+  startSensorConversions();
+  measureVoltage(tp);
+  finishSensorConversions(tp);
+  chMtxUnlock(&sensor_mtx);
 }
 
 /**
  * @brief   Get sensor status and save in datapoint.
  * @notes	The active/installed sensor(s) are read and stored.
+ * @notes	Readings younger than COLL_SENSOR_FRESH_TIME are reused.
  *
  * @post    The provided data point (record) is updated.
  *
@@ -289,72 +455,11 @@ static void measureVoltage(dataPoint_t* tp)
  * @api
  */
 void getSensors(dataPoint_t* tp) {
-	// Measure BME280
-	bme280_error = 0;
-	bme280_t handle;
-
-	// Internal BME280
-	if(BME280_isAvailable(BME280_I1)) {
-		BME280_Init(&handle, BME280_I1);
-		tp->sen_i1_press = BME280_getPressure(&handle, 32);
-		tp->sen_i1_hum = BME280_getHumidity(&handle);
-		tp->sen_i1_temp = BME280_getTemperature(&handle);
-	} else { // No internal BME280 found
-		TRACE_ERROR("COLL > Internal BME280 I1 not operational");
-		tp->sen_i1_press = 0;
-		tp->sen_i1_hum = 0;
-		tp->sen_i1_temp = 0;
-		bme280_error |= 0x1;
-	}
-
-#if     ENABLE_EXTERNAL_I2C == TRUE
-#if     BME280_E1_IS_FITTED == TRUE
-	// External BME280 Sensor 1
-	if(BME280_isAvailable(BME280_E1)) {
-		BME280_Init(&handle, BME280_E1);
-		tp->sen_e1_press = BME280_getPressure(&handle, 32);
-		tp->sen_e1_hum = BME280_getHumidity(&handle);
-		tp->sen_e1_temp = BME280_getTemperature(&handle);
-	} else { // No external BME280 found
-		TRACE_WARN("COLL > External BME280 E1 not operational");
-		tp->sen_e1_press = 0;
-		tp->sen_e1_hum = 0;
-		tp->sen_e1_temp = 0;
-		bme280_error |= 0x4;
-	}
-#else /* BME280_E1_IS_FITTED != TRUE */
-	bme280_error |= 0x8;
-#endif /* BME280_E1_IS_FITTED == TRUE */
-
-#if     BME280_E2_IS_FITTED == TRUE
-	// External BME280 Sensor 2
-	if(BME280_isAvailable(BME280_E2)) {
-		BME280_Init(&handle, BME280_E2);
-		tp->sen_e2_press = BME280_getPressure(&handle, 32);
-		tp->sen_e2_hum = BME280_getHumidity(&handle);
-		tp->sen_e2_temp = BME280_getTemperature(&handle);
-	} else { // No external BME280 found
-		TRACE_WARN("COLL > External BME280 E2 not operational");
-		tp->sen_e2_press = 0;
-		tp->sen_e2_hum = 0;
-		tp->sen_e2_temp = 0;
-		bme280_error |= 0x10;
-	}
-#else /* BME280_E2_IS_FITTED != TRUE */
-	bme280_error |= 0x20;
-#endif /* BME280_E2_IS_FITTED == TRUE */
-
-#else /*  ENABLE_EXTERNAL_I2C != TRUE */
-	/* Set status to "not fitted" for E1 & E2. */
-	bme280_error |= 0x28;
-#endif /*  ENABLE_EXTERNAL_I2C == TRUE */
-	// Measure various temperature sensors
-	/* TODO: Add LLD API to radio. */
-	tp->stm32_temp = stm32_get_temp();
-	tp->si446x_temp = Si446x_getLastTemperature(PKT_RADIO_1);
-
-	// Measure light intensity from OV5640
-	tp->light_intensity = OV5640_getLastLightIntensity() & 0xFFFF;
+  chMtxLock(&sensor_mtx);
+  startSensorConversions();
+  sampleADC();
+  finishSensorConversions(tp);
+  chMtxUnlock(&sensor_mtx);
 }
 
 /**
@@ -479,8 +584,7 @@ THD_FUNCTION(collectorThread, arg) {
     lastDataPoint->gps_state = GPS_OFF;
 
     // Measure telemetry
-    measureVoltage(lastDataPoint);
-    getSensors(lastDataPoint);
+    getTelemetry(lastDataPoint);
     getGPIO(lastDataPoint);
     setSystemStatus(lastDataPoint);
 
@@ -509,8 +613,7 @@ THD_FUNCTION(collectorThread, arg) {
     dataPoint_t* ltp = &dataPoints[ id    % 2]; // Last data point
 
     /* Gather telemetry and system status data. */
-    measureVoltage(tp);
-    getSensors(tp);
+    getTelemetry(tp);
     getGPIO(tp);
     setSystemStatus(tp);
 
@@ -604,6 +707,10 @@ THD_FUNCTION(collectorThread, arg) {
     // Write data point to Flash memory
     flash_writeLogDataPoint(tp);
 
+    // Append data point to log file on SD card (if present)
+    if(initSD())
+      appendBufferToFile("log.bin", (uint8_t*)tp, sizeof(dataPoint_t));
+
     // Switch last data point
     lastDataPoint = tp;
     /* Reply to the calling thread. */
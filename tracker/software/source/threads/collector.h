@@ -5,6 +5,7 @@
 #include "hal.h"
 #include "ptime.h"
 #include "types.h"
+#include "bme280.h"
 
 #define BME_STATUS_BITS         2
 #define BME_STATUS_MASK         0x3
@@ -27,6 +28,16 @@
 #define BME280_E1_IS_FITTED     FALSE
 #define BME280_E2_IS_FITTED     TRUE
 
+/* Sensor readings younger than this are reused for a new data point. */
+#if !defined(COLL_SENSOR_FRESH_TIME)
+#define COLL_SENSOR_FRESH_TIME  TIME_S2I(10)
+#endif
+
+/* Battery and GPS model are checked at this interval while waiting for a fix. */
+#if !defined(COLL_GPS_WAIT_SLICE)
+#define COLL_GPS_WAIT_SLICE     TIME_S2I(5)
+#endif
+
 /**
  * @brief   GPS states as array of strings.
  * @details Each element in an array initialized with this macro can be
@@ -112,6 +123,29 @@ typedef struct {
 } dataPoint_t;
 
 
+/* Cached state of a BME280 for the sensor scheduler. */
+typedef struct {
+  uint8_t     id;         // BME280_I1, BME280_E1 or BME280_E2
+  bool        fitted;
+  bool        setup;      // Handle set up and calibration read
+  bool        triggered;  // Forced conversion in progress
+  bool        valid;      // Cached reading is valid
+  systime_t   time;       // System time of cached reading
+  uint32_t    press;
+  int16_t     temp;
+  uint8_t     hum;
+  bme280_t    handle;
+} bme280_sensor_t;
+
+/* Cached ADC sample for the sensor scheduler. */
+typedef struct {
+  bool        valid;
+  systime_t   time;
+  uint16_t    vbat;
+  uint16_t    vsol;
+  uint16_t    temp;
+} adc_sample_cache_t;
+
 /*typedef struct telemRequest {
   dataPoint_t dp;
   thd_pos_conf_t *conf;
@@ -0,0 +1,211 @@
+/**
+ * @file        power.c
+ * @brief       Battery state of charge and transmit power budget.
+ * @details     The battery power measured by the PAC1720 (in 0.1 mW) is
+ *              integrated into a state of charge estimate in mWs. The
+ *              estimate is corrected to empty or full when the battery
+ *              voltage reaches the configured limits. Image transmission is
+ *              scaled by the state of charge predicted from the present net
+ *              power.
+ *
+ * @addtogroup  telemetry
+ * @{
+ */
+
+#include "ch.h"
+#include "hal.h"
+
+#include "power.h"
+#include "config.h"
+#include "debug.h"
+
+/*===========================================================================*/
+/* Module local variables.                                                   */
+/*===========================================================================*/
+
+static MUTEX_DECL(power_mtx);
+static bool power_valid;
+static int32_t power_energy;    // Battery energy in mWs
+static int16_t power_pbat;      // Last battery power in mW (positive when charging)
+static systime_t power_time;    // System time of last update
+
+/*===========================================================================*/
+/* Module local functions.                                                   */
+/*===========================================================================*/
+
+/**
+ * @brief   Battery capacity in mWs.
+ *
+ * @notapi
+ */
+static int32_t power_capacity(void) {
+  return (int32_t)conf_sram.power.capacity * 3600;
+}
+
+/**
+ * @brief   Estimate battery energy from the battery voltage.
+ * @notes   Linear between the configured empty and full voltages.
+ *
+ * @notapi
+ */
+static int32_t power_energy_from_voltage(uint16_t vbat) {
+  volt_level_t empty = conf_sram.power.vbat_empty;
+  volt_level_t full = conf_sram.power.vbat_full;
+  if(vbat <= empty || full <= empty)
+    return 0;
+  if(vbat >= full)
+    return power_capacity();
+  return (int64_t)power_capacity() * (vbat - empty) / (full - empty);
+}
+
+/*===========================================================================*/
+/* Module exported functions.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   Update the state of charge with a new power measurement.
+ * @notes   Called by the collector with the PAC1720 averages.
+ *
+ * @param[in]   pbat    average battery power in 0.1 mW since the last update
+ *                      (the unit of the PAC1720 driver)
+ * @param[in]   vbat    battery voltage in mV
+ *
+ * @api
+ */
+void power_update(int16_t pbat, uint16_t vbat) {
+  if(conf_sram.power.capacity == 0)
+    return;
+
+  chMtxLock(&power_mtx);
+  systime_t now = chVTGetSystemTime();
+  if(!power_valid) {
+    power_energy = power_energy_from_voltage(vbat);
+    power_valid = true;
+  } else {
+    power_energy += (int64_t)pbat
+        * TIME_I2MS(chTimeDiffX(power_time, now)) / 10000;
+  }
+  /* Re-anchor the integration at the voltage limits. */
+  if(vbat >= conf_sram.power.vbat_full || power_energy > power_capacity())
+    power_energy = power_capacity();
+  if(vbat <= conf_sram.power.vbat_empty || power_energy < 0)
+    power_energy = 0;
+  power_pbat = pbat / 10;
+  power_time = now;
+  chMtxUnlock(&power_mtx);
+
+  if(conf_sram.power.enabled)
+    TRACE_INFO("PWR  > SoC %d%%, Pbat %dmW, scale %d",
+               power_get_soc(), pbat / 10, power_get_scale());
+}
+
+/**
+ * @brief   Get the estimated battery state of charge.
+ *
+ * @return  State of charge in percent.
+ *
+ * @api
+ */
+uint8_t power_get_soc(void) {
+  if(!power_valid || conf_sram.power.capacity == 0)
+    return 100;
+
+  chMtxLock(&power_mtx);
+  int32_t energy = power_energy;
+  chMtxUnlock(&power_mtx);
+
+  return (int64_t)energy * 100 / power_capacity();
+}
+
+/**
+ * @brief   Get the transmit scale from the predicted state of charge.
+ * @notes   The scale is POWER_SCALE_NOMINAL at or above the nominal state
+ *          of charge and falls linearly to the configured minimum. Above
+ *          nominal it rises linearly to the configured maximum at 100%.
+ *
+ * @return  Scale in 1/1000.
+ *
+ * @api
+ */
+uint16_t power_get_scale(void) {
+  if(!conf_sram.power.enabled || !power_valid
+      || conf_sram.power.capacity == 0)
+    return POWER_SCALE_NOMINAL;
+
+  chMtxLock(&power_mtx);
+  int64_t energy = power_energy
+      + (int64_t)power_pbat * TIME_I2S(POWER_SOC_HORIZON);
+  chMtxUnlock(&power_mtx);
+
+  int32_t soc = energy * 100 / power_capacity();
+  soc = (soc < 0) ? 0 : (soc > 100) ? 100 : soc;
+
+  int32_t min = conf_sram.power.scale_min;
+  int32_t max = conf_sram.power.scale_max;
+  int32_t low = conf_sram.power.soc_min;
+  int32_t nom = conf_sram.power.soc_nominal;
+
+  if(soc <= low)
+    return min;
+  if(soc < nom)
+    return min + (POWER_SCALE_NOMINAL - min) * (soc - low) / (nom - low);
+  if(nom >= 100 || max <= POWER_SCALE_NOMINAL)
+    return POWER_SCALE_NOMINAL;
+  return POWER_SCALE_NOMINAL
+      + (max - POWER_SCALE_NOMINAL) * (soc - nom) / (100 - nom);
+}
+
+/**
+ * @brief   Scale a thread cycle time by the power budget.
+ * @notes   A higher scale shortens the cycle.
+ *
+ * @param[in]   cycle   configured cycle time
+ *
+ * @return  Cycle time to be used.
+ *
+ * @api
+ */
+sysinterval_t power_scale_cycle(sysinterval_t cycle) {
+  uint16_t scale = power_get_scale();
+  if(scale == 0)
+    scale = 1;
+  return (uint64_t)cycle * POWER_SCALE_NOMINAL / scale;
+}
+
+/**
+ * @brief   Scale a packet burst length by the power budget.
+ * @notes   The burst is only shortened. It is limited by the buffers.
+ *
+ * @param[in]   burst   configured burst length
+ *
+ * @return  Burst length to be used (at least 1).
+ *
+ * @api
+ */
+uint8_t power_scale_burst(uint8_t burst) {
+  uint16_t scale = power_get_scale();
+  if(scale >= POWER_SCALE_NOMINAL)
+    return burst;
+  uint8_t n = (uint32_t)burst * scale / POWER_SCALE_NOMINAL;
+  return (n == 0) ? 1 : n;
+}
+
+/**
+ * @brief   Scale transmit power by the power budget.
+ * @notes   The power is only reduced, never raised above configuration.
+ *
+ * @param[in]   pwr     configured transmit power
+ *
+ * @return  Transmit power to be used (at least 1).
+ *
+ * @api
+ */
+radio_pwr_t power_scale_pwr(radio_pwr_t pwr) {
+  uint16_t scale = power_get_scale();
+  if(scale >= POWER_SCALE_NOMINAL)
+    return pwr;
+  radio_pwr_t p = (uint32_t)pwr * scale / POWER_SCALE_NOMINAL;
+  return (p == 0) ? 1 : p;
+}
+
+/** @} */
@@ -0,0 +1,23 @@
+#ifndef __POWER_H__
+#define __POWER_H__
+
+#include "ch.h"
+#include "hal.h"
+#include "types.h"
+
+/* Net power is extrapolated over this time to predict the state of charge. */
+#if !defined(POWER_SOC_HORIZON)
+#define POWER_SOC_HORIZON       TIME_S2I(3600)
+#endif
+
+/* Scale of 1/1000 at which the configured cycle, burst and power are used. */
+#define POWER_SCALE_NOMINAL     1000
+
+void          power_update(int16_t pbat, uint16_t vbat);
+uint8_t       power_get_soc(void);
+uint16_t      power_get_scale(void);
+sysinterval_t power_scale_cycle(sysinterval_t cycle);
+uint8_t       power_scale_burst(uint8_t burst);
+radio_pwr_t   power_scale_pwr(radio_pwr_t pwr);
+
+#endif /* __POWER_H__ */
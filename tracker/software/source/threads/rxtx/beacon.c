@@ -86,7 +86,8 @@ THD_FUNCTION(bcnThread, arg) {
                                 0,
                                 conf->radio_conf.pwr,
                                 conf->radio_conf.mod,
-                                conf->radio_conf.cca)) {
+                                conf->radio_conf.cca,
+                                PKT_TX_CLASS_TELEMETRY)) {
               /* Packet is released in transmitOnRadio. */
               TRACE_ERROR("BCN  > Failed to transmit telemetry config");
             }
@@ -113,7 +114,8 @@ THD_FUNCTION(bcnThread, arg) {
                             0,
                             conf->radio_conf.pwr,
                             conf->radio_conf.mod,
-                            conf->radio_conf.cca)) {
+                            conf->radio_conf.cca,
+                            PKT_TX_CLASS_BEACON)) {
           TRACE_ERROR("BCN  > failed to transmit beacon data");
         }
         chThdSleep(TIME_S2I(5));
@@ -146,7 +148,8 @@ THD_FUNCTION(bcnThread, arg) {
                             0,
                             conf->radio_conf.pwr,
                             conf->radio_conf.mod,
-                            conf->radio_conf.cca
+                            conf->radio_conf.cca,
+                            PKT_TX_CLASS_TELEMETRY
         )) {
           TRACE_ERROR("BCN  > Failed to transmit APRSD data");
         }
@@ -9,10 +9,10 @@
 #include "ssdv.h"
 #include "aprs.h"
 #include "radio.h"
-#include "base91.h"
 #include <string.h>
 #include "types.h"
 #include "sleep.h"
+#include "power.h"
 #include "watchdog.h"
 #include "flash.h"
 #include "sd.h"
@@ -815,95 +815,191 @@ bool camera_mtx_init = false;
 
 static bool camInitialized = false;
 
-ssdv_packet_t packetRepeats[16];
+static ssdv_packet_t packetRepeats[IMG_REPEAT_SLOTS];
+static MUTEX_DECL(repeat_mtx);
 bool reject_pri;
 bool reject_sec;
 
-static bool transmit_image_packet(const uint8_t *image,
-                                  uint32_t image_len,
-                                  img_app_conf_t* conf,
-                                  uint8_t image_id,
-                                  uint16_t packet_id) {
-	ssdv_t ssdv;
-	uint8_t pkt[SSDV_PKT_SIZE];
-	uint8_t pkt_base91[256] = {0};
-	const uint8_t *b;
-	uint32_t bi = 0;
-	uint8_t c = SSDV_OK;
-	uint16_t i = 0;
-
-	// Init SSDV (FEC at 2FSK, non FEC at APRS)
-	bi = 0;
-	ssdv_enc_init(&ssdv, SSDV_TYPE_PADDING, "N0CALL", image_id, conf->quality);
-	ssdv_enc_set_buffer(&ssdv, pkt);
-
-	while(true)
-	{
-		while((c = ssdv_enc_get_packet(&ssdv)) == SSDV_FEED_ME)
-		{
-			b = &image[bi];
-			uint8_t r = bi < image_len-128 ? 128 : image_len - bi;
-			bi += r;
-
-			if(r <= 0)
-			{
-				TRACE_ERROR("SSDV > Premature end of file");
-				return false;
-			}
-			ssdv_enc_feed(&ssdv, b, r);
-		}
-
-		if(c == SSDV_EOI) {
-			return true;
-		} else if(c != SSDV_OK) {
-			return false;
-		}
-
-		if(i == packet_id) {
-			// Sync byte, CRC and FEC of SSDV not transmitted (because its not necessary inside an APRS packet)
-			base91_encode(&pkt[6], pkt_base91, 174);
-			packet_t packet = aprs_encode_data_packet(conf->call, conf->path, 'I', pkt_base91);
-            if(packet == NULL) {
-              TRACE_WARN("IMG  > No free packet objects for transmission");
-              return false;
-            }
-            if(!transmitOnRadio(packet,
-                                conf->radio_conf.freq,
-                                0,
-                                0,
-                                conf->radio_conf.pwr,
-                                conf->radio_conf.mod,
-                                conf->radio_conf.cca)) {
-
-              TRACE_ERROR("IMG  > Unable to send image packet on radio");
-              return false;
-            }
-		}
-
-		chThdSleep(TIME_MS2I(10)); // Leave other threads some time
-
-		i++;
-	}
+/*
+ * Find the repeat slot for a packet of an image.
+ * A new slot is started at the packet if no slot covers it.
+ * Slots which have not been served in time are reused.
+ * Returns NULL if all slots are in use. Called with repeat_mtx locked.
+ */
+static ssdv_packet_t* get_repeat_slot(uint8_t image_id, uint16_t packet_id) {
+  ssdv_packet_t *empty = NULL;
+  for(uint8_t i = 0; i < IMG_REPEAT_SLOTS; i++) {
+    ssdv_packet_t *slot = &packetRepeats[i];
+    if(slot->n_done && chVTTimeElapsedSinceX(slot->time) > IMG_REPEAT_TIMEOUT)
+      slot->n_done = false;
+    if(!slot->n_done) {
+      if(empty == NULL)
+        empty = slot;
+      continue;
+    }
+    if(slot->image_id == image_id && packet_id >= slot->packet_id
+        && packet_id - slot->packet_id < IMG_REPEAT_PACKETS)
+      return slot;
+  }
+  if(empty != NULL) {
+    empty->image_id = image_id;
+    empty->packet_id = packet_id;
+    empty->time = chVTGetSystemTime();
+    memset(empty->bitmap, 0, sizeof(empty->bitmap));
+    empty->n_done = true;
+  }
+  return empty;
+}
+
+/*
+ * Queue packets of an image for repeat transmission.
+ * Bit 7 of the first bitmap byte is packet_id, the next bits follow on.
+ * The requests are served by the image thread while it holds the image.
+ * Returns the number of packets queued. Packets without a slot are dropped.
+ */
+uint16_t image_request_repeat(uint8_t image_id, uint16_t packet_id,
+                              const uint8_t *bitmap, uint16_t bits) {
+  uint16_t queued = 0;
+  chMtxLock(&repeat_mtx);
+  for(uint16_t b = 0; b < bits; b++) {
+    if(!(bitmap[b / 8] & (0x80 >> (b % 8))))
+      continue;
+    uint16_t id = packet_id + b;
+    ssdv_packet_t *slot = get_repeat_slot(image_id, id);
+    if(slot == NULL) {
+      TRACE_WARN("IMG  > No repeat slot for image %d packet %d", image_id, id);
+      continue;
+    }
+    uint16_t n = id - slot->packet_id;
+    slot->bitmap[n / 8] |= 0x80 >> (n % 8);
+    queued++;
+  }
+  chMtxUnlock(&repeat_mtx);
+  return queued;
+}
+
+/*
+ * Take the next repeat request of an image out of the queue.
+ */
+static bool take_repeat(uint8_t image_id, ssdv_packet_t *req) {
+  bool found = false;
+  chMtxLock(&repeat_mtx);
+  for(uint8_t i = 0; i < IMG_REPEAT_SLOTS; i++) {
+    if(packetRepeats[i].n_done && packetRepeats[i].image_id == image_id) {
+      *req = packetRepeats[i];
+      packetRepeats[i].n_done = false;
+      found = true;
+      break;
+    }
+  }
+  chMtxUnlock(&repeat_mtx);
+  return found;
+}
+
+/*
+ * Transmit the packets of an image requested for repeat.
+ * The packets of a request are sent in one pass through the SSDV encoder.
+ * Returns false on an encoding error.
+ */
+static bool transmit_image_repeats(const uint8_t *image,
+                                   uint32_t image_len,
+                                   img_app_conf_t* conf,
+                                   uint8_t image_id,
+                                   uint8_t quality) {
+  ssdv_packet_t req;
+  while(take_repeat(image_id, &req)) {
+    ssdv_t ssdv;
+    uint8_t pkt[SSDV_PKT_SIZE];
+    uint32_t bi = 0;
+    uint8_t c;
+
+    ssdv_enc_init(&ssdv, SSDV_TYPE_PADDING, "N0CALL", image_id, quality);
+    ssdv_enc_set_buffer(&ssdv, pkt);
+
+    for(uint16_t i = 0; i < req.packet_id + IMG_REPEAT_PACKETS; i++) {
+      while((c = ssdv_enc_get_packet(&ssdv)) == SSDV_FEED_ME) {
+        uint32_t r = image_len - bi > 128 ? 128 : image_len - bi;
+        if(r == 0) {
+          TRACE_ERROR("SSDV > Premature end of file");
+          return false;
+        }
+        ssdv_enc_feed(&ssdv, &image[bi], r);
+        bi += r;
+      }
+      if(c == SSDV_EOI)
+        break;
+      if(c != SSDV_OK)
+        return false;
+
+      uint16_t n = i - req.packet_id;
+      if(i < req.packet_id || !(req.bitmap[n / 8] & (0x80 >> (n % 8))))
+        continue;
+
+      TRACE_INFO("IMG  > Repeat image %d packet %d", image_id, i);
+      /*
+       * Sync byte, CRC and FEC of SSDV not transmitted.
+       * Not necessary inside an APRS packet.
+       */
+      packet_t packet = aprs_encode_data_packet(conf->call, conf->path,
+                                                'I', &pkt[6], 174);
+      if(packet == NULL) {
+        TRACE_WARN("IMG  > No free packet objects for transmission");
+        continue;
+      }
+      if(!transmitOnRadio(packet,
+                          conf->radio_conf.freq,
+                          0,
+                          0,
+                          power_scale_pwr(conf->radio_conf.pwr),
+                          conf->radio_conf.mod,
+                          conf->radio_conf.cca,
+                          PKT_TX_CLASS_IMAGE)) {
+        TRACE_ERROR("IMG  > Unable to send image packet on radio");
+      } else if(conf->svc_conf.send_spacing) {
+        chThdSleep(conf->svc_conf.send_spacing);
+      }
+      chThdSleep(TIME_MS2I(10)); // Leave other threads some time
+    }
+  }
+  return true;
+}
+
+/*
+ * Check the reject flag of the image thread, optionally clearing it.
+ * The flag is set by the "reject" command.
+ */
+static bool image_rejected(img_app_conf_t* conf, bool clear) {
+  bool *flag = (conf == &conf_sram.img_pri) ? &reject_pri
+      : (conf == &conf_sram.img_sec) ? &reject_sec : NULL;
+  if(flag == NULL || !*flag)
+    return false;
+  if(clear)
+    *flag = false;
+  return true;
 }
 
 /*
  * Transmit image packets.
+ * Transmission stops when the image is rejected.
  * Return true if no SSDV encoding error or false on encoding error.
  */
 static bool transmit_image_packets(const uint8_t *image,
                                    uint32_t image_len,
                                    img_app_conf_t* conf,
-                                   uint8_t image_id) {
+                                   uint8_t image_id,
+                                   uint8_t quality) {
 
   uint8_t pkt[SSDV_PKT_SIZE];
-  uint8_t pkt_base91[256] = {0};
+  uint8_t pkt_last[174];
+  bool have_last = false;
 
   /* FIXME: This doesn't work with burst mode packet sends. */
   // Process redundant transmission from last cycle
-  if(strlen((char*)pkt_base91)
+  if(have_last
       && conf->redundantTx) {
     packet_t packet = aprs_encode_data_packet(conf->call, conf->path,
-                                              'I', pkt_base91);
+                                              'I', pkt_last,
+                                              sizeof(pkt_last));
     if(packet == NULL) {
       TRACE_ERROR("IMG  > No available packet for redundant"
           " image transmission");
@@ -912,9 +1008,10 @@ static bool transmit_image_packets(const uint8_t *image,
                           conf->radio_conf.freq,
                           0,
                           0,
-                          conf->radio_conf.pwr,
+                          power_scale_pwr(conf->radio_conf.pwr),
                           conf->radio_conf.mod,
-                          conf->radio_conf.cca)) {
+                          conf->radio_conf.cca,
+                          PKT_TX_CLASS_IMAGE)) {
         /* Packet has been released by transmit. */
         TRACE_ERROR("IMG  > Unable to send redundant image on radio");
       }
@@ -929,12 +1026,17 @@ static bool transmit_image_packets(const uint8_t *image,
   uint8_t c = SSDV_OK;
 
   /* Initialize SSDV, output buffer and input buffer. */
-  ssdv_enc_init(&ssdv, SSDV_TYPE_PADDING, "N0CALL", image_id, conf->quality);
+  ssdv_enc_init(&ssdv, SSDV_TYPE_PADDING, "N0CALL", image_id, quality);
   ssdv_enc_set_buffer(&ssdv, pkt);
   ssdv_enc_feed(&ssdv, image, 0);
 
   while(c != SSDV_EOI) {
 
+    if(image_rejected(conf, false)) {
+      TRACE_INFO("IMG  > Image %d rejected", image_id);
+      break;
+    }
+
     /*
      * Next encode packets.
      * Packet burst send is available if redundant TX is not requested.
@@ -943,7 +1045,7 @@ static bool transmit_image_packets(const uint8_t *image,
                            MAX_BUFFERS_FOR_BURST_SEND);
     uint8_t chain = (conf->radio_conf.mod == MOD_2FSK
         && !conf->redundantTx) ?
-        buffers : 1;
+        power_scale_burst(buffers) : 1;
     TRACE_INFO("IMG  > Encode %i APRS/SSDV packet%s", chain,
                (chain > 1 ? " burst" : ""));
 
@@ -979,10 +1081,8 @@ static bool transmit_image_packets(const uint8_t *image,
        * Sync byte, CRC and FEC of SSDV not transmitted.
        * Not necessary inside an APRS packet.
        */
-      base91_encode(&pkt[6], pkt_base91, 174);
-
       packet_t packet = aprs_encode_data_packet(conf->call, conf->path,
-                                                'I', pkt_base91);
+                                                'I', &pkt[6], 174);
       if(packet == NULL) {
         TRACE_ERROR("IMG  > No available packet for image transmission");
         /* Error so release any linked packets. */
@@ -1007,9 +1107,10 @@ static bool transmit_image_packets(const uint8_t *image,
                           conf->radio_conf.freq,
                           0,
                           0,
-                          conf->radio_conf.pwr,
+                          power_scale_pwr(conf->radio_conf.pwr),
                           conf->radio_conf.mod,
-                          conf->radio_conf.cca)) {
+                          conf->radio_conf.cca,
+                          PKT_TX_CLASS_IMAGE)) {
         TRACE_ERROR("IMG  > Unable to send image on radio");
         /* Transmit on radio will release the packet chain. */
       } else {
@@ -1021,27 +1122,96 @@ static bool transmit_image_packets(const uint8_t *image,
       chThdSleep(TIME_MS2I(10)); // Leave other threads some time
   } /* End while(c!= SSDV_EOI) */
 
-  // Repeat packets
-  for(uint8_t i=0; i<16; i++) {
-    if(packetRepeats[i].n_done && image_id == packetRepeats[i].image_id) {
-      if(!transmit_image_packet(image, image_len, conf,
-                                image_id, packetRepeats[i].packet_id)) {
-        TRACE_ERROR("IMG  > Failed re-send of image %i", image_id);
-      } else {
-        packetRepeats[i].n_done = false; // Set done
-      }
-    }
-    chThdSleep(TIME_MS2I(10)); // Leave other threads some time
+  // Repeat packets requested while the image was sent
+  if(!transmit_image_repeats(image, image_len, conf, image_id, quality)) {
+    TRACE_ERROR("IMG  > Failed re-send of image %i", image_id);
   }
+  return true;
+}
+
+/*
+ * Packets per image at each SSDV quality relative to quality 7 in percent.
+ * Averaged over the flight images of the repository (decoder/ssdvdec).
+ */
+static const uint8_t quality_ratio[8] = {10, 22, 38, 41, 42, 54, 70, 100};
 
-  // Handle image rejection flag
-  if((conf == &conf_sram.img_pri) && reject_pri) { // Image rejected
-    reject_pri = false;
+/*
+ * Count the packets of an image at a quality by a dry run of the encoder.
+ * Returns 0 on an encoding error.
+ */
+static uint16_t count_image_packets(const uint8_t *image,
+                                    uint32_t image_len,
+                                    uint8_t quality) {
+  ssdv_t ssdv;
+  uint8_t pkt[SSDV_PKT_SIZE];
+  uint32_t bi = 0;
+  uint16_t n = 0;
+  uint8_t c;
+
+  ssdv_enc_init(&ssdv, SSDV_TYPE_PADDING, "N0CALL", 0, quality);
+  ssdv_enc_set_buffer(&ssdv, pkt);
+
+  while(true) {
+    while((c = ssdv_enc_get_packet(&ssdv)) == SSDV_FEED_ME) {
+      uint32_t r = image_len - bi > 128 ? 128 : image_len - bi;
+      if(r == 0)
+        return 0;
+      ssdv_enc_feed(&ssdv, &image[bi], r);
+      bi += r;
+    }
+    if(c == SSDV_EOI)
+      return n;
+    if(c != SSDV_OK)
+      return 0;
+    n++;
   }
-  if((conf == &conf_sram.img_sec) && reject_sec) { // Image rejected
-    reject_sec = false;
+}
+
+/*
+ * Configured SSDV quality, limited to the highest quality of the encoder.
+ */
+static uint8_t max_image_quality(const img_app_conf_t* conf) {
+  return conf->quality > 7 ? 7 : conf->quality;
+}
+
+/*
+ * Select the highest quality up to the configured one at which the image
+ * fits into the packet budget. The count of the configured quality is used
+ * to estimate the quality which fits, the image is counted again only for
+ * the estimated quality and below. Returns the quality, the packet count
+ * is written to packets (0 on an encoding error).
+ */
+static uint8_t select_image_quality(const uint8_t *image,
+                                    uint32_t image_len,
+                                    img_app_conf_t* conf,
+                                    uint16_t *packets) {
+  uint8_t max = max_image_quality(conf);
+  uint8_t quality = max;
+  uint16_t n = count_image_packets(image, image_len, quality);
+
+  if(n > conf->packets) {
+    uint32_t full = (uint32_t)n * 100 / quality_ratio[max];
+    while(quality > 0 && full * quality_ratio[quality] / 100 > conf->packets)
+      quality--;
+    n = count_image_packets(image, image_len, quality);
+    while(n > conf->packets && quality > 0)
+      n = count_image_packets(image, image_len, --quality);
   }
-  return true;
+  TRACE_INFO("IMG  > Quality %d of %d, %d packets (budget %d)",
+             quality, max, n, conf->packets);
+  *packets = n;
+  return quality;
+}
+
+/*
+ * Next lower or higher resolution for the packet budget.
+ * The zoomed VGA mode has a different field of view and is skipped.
+ */
+static resolution_t step_resolution(resolution_t res, bool up) {
+  do {
+    res = up ? res + 1 : res - 1;
+  } while(res == RES_VGA_ZOOMED);
+  return res;
 }
 
 /**
@@ -1173,8 +1343,29 @@ THD_FUNCTION(imgThread, arg) {
   // Create buffer
   //uint8_t buffer[conf->buf_size] __attribute__((aligned(DMA_FIFO_BURST_ALIGN)));
 
+  /*
+   * The capture buffer of the last image is held until the next cycle to
+   * serve repeat requests. It is freed before the next one is allocated.
+   */
+  uint8_t *held = NULL;
+  uint32_t held_len = 0;
+  uint8_t held_id = 0;
+  uint8_t held_quality = 0;
+
+  /* Resolution adapted to the packet budget. */
+  resolution_t res = conf->res;
+
   sysinterval_t time = chVTGetSystemTime();
   while(true) {
+    if(held != NULL) {
+      if(!transmit_image_repeats(held, held_len, conf, held_id,
+                                 held_quality)) {
+        TRACE_ERROR("IMG  > Failed re-send of image %i", held_id);
+      }
+      chHeapFree(held);
+      held = NULL;
+    }
+
     char code_s[100];
     pktDisplayFrequencyCode(conf->radio_conf.freq,
                                               code_s, sizeof(code_s));
@@ -1185,7 +1376,14 @@ THD_FUNCTION(imgThread, arg) {
       chThdSleep(TIME_S2I(60));
       continue;
     }
-    uint32_t my_image_id = gimage_id++;
+    /*
+     * Reserve the image IDs of this cycle at once. With a preview the
+     * preview gets the first ID and the image the one after it.
+     */
+    chSysLock();
+    uint32_t my_image_id = gimage_id;
+    gimage_id += (conf->preview != PREVIEW_NONE) ? 2 : 1;
+    chSysUnlock();
     /* Create image capture buffer. */
     uint8_t *buffer = chHeapAllocAligned(NULL, conf->buf_size,
                                          DMA_FIFO_BURST_ALIGN);
@@ -1196,7 +1394,7 @@ THD_FUNCTION(imgThread, arg) {
       /* Allow time for other threads. */
       chThdSleep(TIME_MS2I(10));
       /* Try again at next run time. */
-      time = waitForTrigger(time, conf->svc_conf.cycle);
+      time = waitForTrigger(time, power_scale_cycle(conf->svc_conf.cycle));
       continue;
     }
     /*
@@ -1209,14 +1407,17 @@ THD_FUNCTION(imgThread, arg) {
     for(uint32_t i = 0; i < size ; i++)
         buffer[i] = 0;*/
     /* Take picture. */
+    if(conf->packets == 0 || res > conf->res)
+      res = conf->res;
     uint32_t size_sampled = takePicture(buffer, conf->buf_size,
-                                        conf->res, true);
+                                        res, true);
     /* Nothing captured? */
     if(size_sampled == 0) {
       TRACE_INFO("IMG  > Encode/Transmit SSDV (camera error) ID=%d",
                  my_image_id);
       if(!transmit_image_packets(noCameraFound, sizeof(noCameraFound),
-                                 conf, (uint8_t)(my_image_id))) {
+                                 conf, (uint8_t)(my_image_id),
+                                 conf->quality)) {
         TRACE_ERROR("IMG  > Error in encoding dummy image %i"
             " - discarded", my_image_id);
       }
@@ -1225,19 +1426,25 @@ THD_FUNCTION(imgThread, arg) {
       /* Allow time for other threads. */
       chThdSleep(TIME_MS2I(10));
       /* Try again at next run time. */
-      time = waitForTrigger(time, conf->svc_conf.cycle);
+      time = waitForTrigger(time, power_scale_cycle(conf->svc_conf.cycle));
       continue;
     }
 
     /* Find SOI in image buffer. */
     uint32_t soi = 0;
     bool soi_found = false;
+    uint8_t quality = conf->quality;
+    uint8_t image_id = (uint8_t)my_image_id;
+    sd_job_t *sd_job = NULL;
     while(soi < (size_sampled - 1)) {
       if(buffer[soi] == 0xFF && buffer[soi + 1] == 0xD8) {
         /* Found an SOI. */
         soi_found = true;
         TRACE_INFO("IMG  > SOI at index %i of buffer", soi);
-        /* Write to SD if present. */
+        /*
+         * Write to SD if present.
+         * The SD thread writes while the image is being transmitted.
+         */
         if(initSD()) {
           char filename[32];
           // Write picture to SD card
@@ -1247,7 +1454,8 @@ THD_FUNCTION(imgThread, arg) {
                      getLastDataPoint()->reset % 0xFF,
                      (my_image_id) % 0xFFFF);
 
-          writeBufferToFile(filename, &buffer[soi], size_sampled - soi);
+          sd_job = writeBufferToFileAsync(filename, &buffer[soi],
+                                          size_sampled - soi);
         } /* End initSD() */
 
         /* Transmit on radio. */
@@ -1255,12 +1463,77 @@ THD_FUNCTION(imgThread, arg) {
           TRACE_WARN("IMG  > Redundant TX disables 2FSK burst send mode");
         }
 
+        /*
+         * Fit the image into the packet budget.
+         * The resolution of the next image is lowered if even the lowest
+         * quality does not fit and raised again if the highest one fits
+         * into half of the budget.
+         */
+        if(conf->packets != 0) {
+          uint16_t packets;
+          quality = select_image_quality(buffer, size_sampled, conf,
+                                         &packets);
+          if(packets > conf->packets && res > RES_QQVGA) {
+            res = step_resolution(res, false);
+            TRACE_INFO("IMG  > Lower resolution for packet budget");
+          } else if(quality == max_image_quality(conf)
+              && packets <= conf->packets / 2
+              && res < conf->res) {
+            res = step_resolution(res, true);
+            TRACE_INFO("IMG  > Raise resolution for packet budget");
+          }
+        }
+
+        /* A reject applies to the image sent from now on. */
+        image_rejected(conf, true);
+
+        /*
+         * Send a quality 0 preview of the same image first.
+         * The image itself gets the next image ID. It is not sent if the
+         * preview is rejected in time. In preview only mode its packets
+         * are sent on repeat requests only.
+         */
+        if(conf->preview != PREVIEW_NONE) {
+          image_id = (uint8_t)(my_image_id + 1);
+          TRACE_INFO("IMG  > Encode/Transmit SSDV preview ID=%d of ID=%d",
+                     my_image_id, image_id);
+          if(!transmit_image_packets(buffer, size_sampled, conf,
+                                     (uint8_t)(my_image_id), 0)) {
+            TRACE_ERROR("IMG  > Error in encoding preview image"
+                " %i - discarded", my_image_id);
+          }
+          if(conf->preview == PREVIEW_FIRST && !image_rejected(conf, false))
+            chThdSleep(conf->preview_wait);
+        }
+
         /* Encode and transmit picture. */
-        TRACE_INFO("IMG  > Encode/Transmit SSDV ID=%d", my_image_id);
-        if(!transmit_image_packets(buffer, size_sampled, conf,
-                                   (uint8_t)(my_image_id))) {
-          TRACE_ERROR("IMG  > Error in encoding snapshot image"
-              " %i - discarded", my_image_id);
+        if(image_rejected(conf, true)) {
+          TRACE_INFO("IMG  > Image %d rejected", image_id);
+        } else if(conf->preview == PREVIEW_ONLY) {
+          /*
+           * Announce the held image with its first and last packet.
+           * They give the ground the image ID, size and packet count, so
+           * any region of the image can be requested with nack.
+           */
+          uint16_t n = count_image_packets(buffer, size_sampled, quality);
+          const uint8_t one = 0x80;
+          TRACE_INFO("IMG  > Hold SSDV ID=%d (%d packets) for repeat requests",
+                     image_id, n);
+          image_request_repeat(image_id, 0, &one, 1);
+          if(n > 1)
+            image_request_repeat(image_id, n - 1, &one, 1);
+          if(!transmit_image_repeats(buffer, size_sampled, conf,
+                                     image_id, quality)) {
+            TRACE_ERROR("IMG  > Error in encoding held image"
+                " %i - discarded", image_id);
+          }
+        } else {
+          TRACE_INFO("IMG  > Encode/Transmit SSDV ID=%d", image_id);
+          if(!transmit_image_packets(buffer, size_sampled, conf,
+                                     image_id, quality)) {
+            TRACE_ERROR("IMG  > Error in encoding snapshot image"
+                " %i - discarded", image_id);
+          }
         }
       break;
       } /* End if SOI in buffer. */
@@ -1269,12 +1542,23 @@ THD_FUNCTION(imgThread, arg) {
     if(!soi_found) { /* No SOI found. */
     TRACE_INFO("IMG  > No SOI found in image");
     }
-    /* Return the buffer to the heap. */
-    chHeapFree(buffer);
+    /* The SD write references the buffer so wait for it to complete. */
+    if(sd_job != NULL && !waitWriteComplete(sd_job)) {
+      TRACE_ERROR("IMG  > Error saving image %i to SD card", my_image_id);
+    }
+    /* Keep the image for repeat requests, else return the buffer to the heap. */
+    if(soi_found) {
+      held = buffer;
+      held_len = size_sampled;
+      held_id = image_id;
+      held_quality = quality;
+    } else {
+      chHeapFree(buffer);
+    }
     /* Allow minimum time for other threads. */
     chThdSleep(TIME_MS2I(10));
     /* Update next run time. */
-    time = waitForTrigger(time, conf->svc_conf.cycle);
+    time = waitForTrigger(time, power_scale_cycle(conf->svc_conf.cycle));
   }
 }
 
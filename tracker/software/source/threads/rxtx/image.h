@@ -5,17 +5,23 @@
 #include "hal.h"
 #include "types.h"
 
+#define IMG_REPEAT_SLOTS	8					// Number of pending packet repeat requests
+#define IMG_REPEAT_PACKETS	256					// Packets covered by one repeat request
+#define IMG_REPEAT_TIMEOUT	TIME_S2I(3600)		// Requests not served within this time are discarded
+
 typedef struct {
-	uint16_t packet_id;
+	uint16_t packet_id;							// First packet of the bitmap
 	uint8_t image_id;
 	bool n_done;
+	systime_t time;								// Time of the request
+	uint8_t bitmap[IMG_REPEAT_PACKETS / 8];		// Packets to be repeated, MSB first
 } ssdv_packet_t;
 
-extern ssdv_packet_t packetRepeats[16];
 extern bool reject_pri;
 extern bool reject_sec;
 
 void start_image_thread(img_app_conf_t *conf);
+uint16_t image_request_repeat(uint8_t image_id, uint16_t packet_id, const uint8_t *bitmap, uint16_t bits);
 uint32_t takePicture(uint8_t* buffer, uint32_t size, resolution_t resolution, bool enableJpegValidation);
 extern mutex_t camera_mtx;
 extern uint32_t gimage_id;
@@ -8,7 +8,6 @@
 
 #include "debug.h"
 #include "threads.h"
-#include "base91.h"
 #include "aprs.h"
 #include "sleep.h"
 #include "radio.h"
@@ -52,11 +51,9 @@ THD_FUNCTION(logThread, arg)
 			dataPoint_t *log = getNextLogDataPoint(conf->density);
 
 			if(log) {
-				// Encode Base91
-				uint8_t pkt_base91[BASE91LEN(sizeof(dataPoint_t))];
-				base91_encode((uint8_t*)log, pkt_base91, sizeof(dataPoint_t));
 				// Encode and transmit log packet
-				packet_t packet = aprs_encode_data_packet(conf->call, conf->path, 'L', pkt_base91); // Encode packet
+				packet_t packet = aprs_encode_data_packet(conf->call, conf->path, 'L',
+				                                          (uint8_t*)log, sizeof(dataPoint_t)); // Encode packet
 	            if(packet == NULL) {
 	              TRACE_WARN("LOG  > No free packet objects for log transmission");
 	            } else {
@@ -67,7 +64,8 @@ THD_FUNCTION(logThread, arg)
                                   0,
                                   conf->radio_conf.pwr,
                                   conf->radio_conf.mod,
-                                  conf->radio_conf.cca);
+                                  conf->radio_conf.cca,
+                                  PKT_TX_CLASS_TELEMETRY);
 	            }
 			} else {
 				TRACE_INFO("LOG  > No log point in memory");
@@ -105,7 +105,8 @@ void start_aprs_threads(radio_unit_t radio, radio_freq_t base_freq,
 bool transmitOnRadio(packet_t pp, const radio_freq_t base_freq,
                      const channel_hz_t step, radio_ch_t chan,
                      const radio_pwr_t pwr, const mod_t mod,
-                     const radio_squelch_t cca) {
+                     const radio_squelch_t cca,
+                     const radio_tx_class_t tx_class) {
   /* Select a radio by frequency. */
   radio_unit_t radio = pktSelectRadioForFrequency(base_freq,
                                                   step,
@@ -178,6 +179,7 @@ bool transmitOnRadio(packet_t pp, const radio_freq_t base_freq,
     rt.tx_speed = (mod == MOD_2FSK ? 9600 : 1200);
     rt.squelch = cca;
     rt.packet_out = pp;
+    rt.tx_class = tx_class;
 
     /* Update the task mirror. */
     handler->radio_tx_config = rt;
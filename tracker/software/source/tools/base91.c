@@ -54,12 +54,6 @@ const unsigned char b91_table[91] = {
 	'>', '?', '@', '[', ']', '^', '_', '`', '{', '-', '}', '~', '"'
 };
 
-typedef struct {
-	uint64_t queue;
-	uint64_t nbits;
-	uint32_t val;
-} base91_t;
-
 void base64_encode(const uint8_t *in, uint8_t *out, uint16_t input_length) {
 	uint32_t i,j;
 	for(i=0, j=0; i<input_length;) {
@@ -81,68 +75,85 @@ void base64_encode(const uint8_t *in, uint8_t *out, uint16_t input_length) {
 	out[BASE64LEN(input_length)] = '\0';
 }
 
-void basE91_init(base91_t *b)
+/**
+ * Writes a 13 or 14 bit value as two basE91 digits.
+ * The division by 91 is done by multiplication with 2^22/91 (rounded up),
+ * which is exact for all values below 2^14.
+ */
+static inline uint8_t* base91_put_value(uint8_t *out, uint32_t val)
+{
+	uint32_t q = (val * 46092) >> 22;
+	*out++ = b91_table[val - q * 91];
+	*out++ = b91_table[q];
+	return out;
+}
+
+void base91_init(base91_t *b)
 {
 	b->queue = 0;
 	b->nbits = 0;
-	b->val = -1;
 }
 
-size_t basE91_encode(base91_t *b, const void *i, size_t len, void *o)
+/**
+ * Encodes the next part of a stream. Output is written directly to out,
+ * which must hold BASE91LEN(len) bytes.
+ * Returns the number of bytes written.
+ */
+size_t base91_put(base91_t *b, const uint8_t *in, size_t len, uint8_t *out)
 {
-	const uint8_t *ib = i;
-	uint8_t *ob = o;
-	size_t n = 0;
-
-	while (len--) {
-		b->queue |= *ib++ << b->nbits;
-		b->nbits += 8;
-		if (b->nbits > 13) {	/* enough bits in queue */
-			uint32_t val = b->queue & 8191;
-
-			if (val > 88) {
-				b->queue >>= 13;
-				b->nbits -= 13;
-			} else {	/* we can take 14 bits */
-				val = b->queue & 16383;
-				b->queue >>= 14;
-				b->nbits -= 14;
+	uint8_t *o = out;
+	uint32_t queue = b->queue;
+	uint32_t nbits = b->nbits;
+
+	while(len--) {
+		queue |= (uint32_t)*in++ << nbits;
+		nbits += 8;
+		if(nbits > 13) { // Enough bits in queue
+			uint32_t val = queue & 8191;
+			if(val > 88) {
+				queue >>= 13;
+				nbits -= 13;
+			} else { // We can take 14 bits
+				val = queue & 16383;
+				queue >>= 14;
+				nbits -= 14;
 			}
-			ob[n++] = b91_table[val % 91];
-			ob[n++] = b91_table[val / 91];
+			o = base91_put_value(o, val);
 		}
 	}
 
-	return n;
+	b->queue = queue;
+	b->nbits = nbits;
+	return o - out;
 }
 
-size_t basE91_encode_end(base91_t *b, void *o)
+/**
+ * Flushes the remaining bits of a stream (up to 2 bytes) and resets the state.
+ * Returns the number of bytes written.
+ */
+size_t base91_end(base91_t *b, uint8_t *out)
 {
-	uint8_t *ob = o;
 	size_t n = 0;
 
-	if (b->nbits) {
-		ob[n++] = b91_table[b->queue % 91];
-		if (b->nbits > 7 || b->queue > 90)
-			ob[n++] = b91_table[b->queue / 91];
+	if(b->nbits) {
+		uint32_t q = (b->queue * 46092) >> 22;
+		out[n++] = b91_table[b->queue - q * 91];
+		if(b->nbits > 7 || b->queue > 90)
+			out[n++] = b91_table[q];
 	}
-	b->queue = 0;
-	b->nbits = 0;
-	b->val = -1;
+	base91_init(b);
 
 	return n;
 }
 
+/**
+ * Encodes a complete buffer. The output is not terminated.
+ * Returns the number of bytes written (at most BASE91LEN(input_length)).
+ */
 size_t base91_encode(const uint8_t *in, uint8_t *out, uint16_t input_length) {
 	base91_t handle;
 
-	uint32_t ototal = 0;
-	for(uint32_t i=0; i<(uint32_t)BASE91LEN(input_length); i++)
-		out[i] = 0;
-
-	basE91_init(&handle);
-	ototal += basE91_encode(&handle, in, input_length, out);
-	ototal += basE91_encode_end(&handle, out + ototal);
-	return ototal;
+	base91_init(&handle);
+	size_t n = base91_put(&handle, in, input_length, out);
+	return n + base91_end(&handle, out + n);
 }
-
@@ -8,7 +8,16 @@
 #define BASE64LEN(in) (4 * (((in) + 2) / 3))
 #define BASE91LEN(in) ((((in)*16)+26) / 13)
 
+/* Streaming basE91 encoder state (at most 21 bits are queued) */
+typedef struct {
+	uint32_t queue;
+	uint32_t nbits;
+} base91_t;
+
 void base64_encode(const uint8_t *in, uint8_t *out, uint16_t input_length);
+void base91_init(base91_t *b);
+size_t base91_put(base91_t *b, const uint8_t *in, size_t len, uint8_t *out);
+size_t base91_end(base91_t *b, uint8_t *out);
 size_t base91_encode(const uint8_t *in, uint8_t *out, uint16_t input_length);
 
 #endif